@@ -0,0 +1,233 @@
+// Arithmetic microbenchmarks for bits::container against
+// boost::multiprecision::cpp_int. Every operation is timed on the same
+// random operands for both types, checked for agreement once, and the
+// results are printed as JSON:
+//
+//   bitsBench [--min-bits N] [--max-bits N] [--min-time-ms T] [--op NAME]
+//
+// Sizes double from --min-bits (default 64) to --max-bits (default 1M).
+#include "../src/bits.hpp"
+#include <algorithm>
+#include <boost/multiprecision/cpp_int.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using boost::multiprecision::cpp_int;
+
+namespace {
+
+struct options {
+  uint64_t min_bits = 64;
+  uint64_t max_bits = uint64_t(1) << 20;
+  double min_time_ms = 50;
+  std::string only_op;
+};
+
+struct operands {
+  bits::container a, b, wide, near_a;
+  cpp_int ca, cb, cwide, cnear_a;
+};
+
+// Keeps results observable so the timed calls are not optimized out
+volatile uint64_t sink;
+
+std::vector<uint64_t> random_blocks(std::mt19937_64 &rng, uint64_t bit_count) {
+  std::vector<uint64_t> blocks((bit_count + 63) / 64);
+  for (uint64_t &block : blocks)
+    block = rng();
+  if (bit_count % 64)
+    blocks.back() &= (uint64_t(1) << (bit_count % 64)) - 1;
+  // Full-size operands: the top bit is always set
+  blocks.back() |= uint64_t(1) << ((bit_count - 1) % 64);
+  return blocks;
+}
+
+cpp_int to_cpp_int(const std::vector<uint64_t> &blocks) {
+  cpp_int result;
+  boost::multiprecision::import_bits(result, blocks.begin(), blocks.end(), 64,
+                                     false);
+  return result;
+}
+
+cpp_int to_cpp_int(const bits::container &value) {
+  std::vector<uint64_t> blocks(value.data(), value.data() + value.blocks());
+  return to_cpp_int(blocks);
+}
+
+operands make_operands(std::mt19937_64 &rng, uint64_t bit_count) {
+  std::vector<uint64_t> a = random_blocks(rng, bit_count);
+  std::vector<uint64_t> b = random_blocks(rng, bit_count);
+  std::vector<uint64_t> wide = random_blocks(rng, 2 * bit_count);
+  // Keep a >= b so that sub does not saturate
+  if (std::lexicographical_compare(a.rbegin(), a.rend(), b.rbegin(),
+                                   b.rend()))
+    std::swap(a, b);
+  // Same as a except for the lowest bit: compare has to scan everything
+  std::vector<uint64_t> near_a = a;
+  near_a[0] ^= 1;
+  return {bits::container::from_blocks(a.data(), a.size()),
+          bits::container::from_blocks(b.data(), b.size()),
+          bits::container::from_blocks(wide.data(), wide.size()),
+          bits::container::from_blocks(near_a.data(), near_a.size()),
+          to_cpp_int(a),
+          to_cpp_int(b),
+          to_cpp_int(wide),
+          to_cpp_int(near_a)};
+}
+
+// Average nanoseconds per call, repeating until min_time_ms has passed
+double time_ns(const std::function<void()> &body, double min_time_ms) {
+  using clock = std::chrono::steady_clock;
+  uint64_t iterations = 0;
+  auto start = clock::now();
+  std::chrono::duration<double, std::milli> elapsed{};
+  do {
+    body();
+    ++iterations;
+    elapsed = clock::now() - start;
+  } while (elapsed.count() < min_time_ms);
+  return elapsed.count() * 1e6 / iterations;
+}
+
+struct benchmark {
+  std::string_view name;
+  std::function<void(const operands &)> run_container;
+  std::function<void(const operands &)> run_cpp_int;
+  // Runs both sides once, untimed, and compares the results
+  std::function<bool(const operands &)> agree;
+  // Largest operand size worth running (cpp_int string output is quadratic)
+  uint64_t max_bits = UINT64_MAX;
+};
+
+// An operation producing a number on both sides
+template <typename ContainerOp, typename CppIntOp>
+benchmark arithmetic(std::string_view name, ContainerOp container_op,
+                     CppIntOp cpp_int_op) {
+  return {name,
+          [=](const operands &x) { sink = container_op(x).blocks(); },
+          [=](const operands &x) { sink = cpp_int_op(x).backend().size(); },
+          [=](const operands &x) {
+            return to_cpp_int(container_op(x)) == cpp_int_op(x);
+          }};
+}
+
+constexpr uint64_t SHIFT = 97;
+
+std::vector<benchmark> benchmarks() {
+  using bits::container;
+  return {
+      arithmetic(
+          "add", [](const operands &x) { return x.a + x.b; },
+          [](const operands &x) -> cpp_int { return x.ca + x.cb; }),
+      arithmetic(
+          "sub", [](const operands &x) { return x.a - x.b; },
+          [](const operands &x) -> cpp_int { return x.ca - x.cb; }),
+      arithmetic(
+          "mul", [](const operands &x) { return x.a * x.b; },
+          [](const operands &x) -> cpp_int { return x.ca * x.cb; }),
+      arithmetic(
+          "square", [](const operands &x) { return x.a.square(); },
+          [](const operands &x) -> cpp_int { return x.ca * x.ca; }),
+      // Quotient and remainder folded together so both are checked
+      arithmetic(
+          "divmod",
+          [](const operands &x) {
+            auto [quotient, remainder] = divmod(x.wide, x.a);
+            return quotient ^ remainder;
+          },
+          [](const operands &x) -> cpp_int {
+            cpp_int quotient, remainder;
+            boost::multiprecision::divide_qr(x.cwide, x.ca, quotient,
+                                             remainder);
+            return quotient ^ remainder;
+          }),
+      arithmetic(
+          "shl", [](const operands &x) { return x.a << SHIFT; },
+          [](const operands &x) -> cpp_int { return x.ca << SHIFT; }),
+      arithmetic(
+          "shr", [](const operands &x) { return x.a >> SHIFT; },
+          [](const operands &x) -> cpp_int { return x.ca >> SHIFT; }),
+      {"compare", [](const operands &x) { sink = x.a < x.near_a; },
+       [](const operands &x) { sink = x.ca < x.cnear_a; },
+       [](const operands &x) {
+         return (x.a < x.near_a) == (x.ca < x.cnear_a);
+       }},
+      {"to_string",
+       [](const operands &x) { sink = x.a.convert_to_base(10).size(); },
+       [](const operands &x) { sink = x.ca.str().size(); },
+       [](const operands &x) { return x.a.convert_to_base(10) == x.ca.str(); },
+       uint64_t(1) << 18},
+  };
+}
+
+options parse_options(int argc, char **argv) {
+  options result;
+  for (int idx = 1; idx < argc; ++idx) {
+    std::string_view arg = argv[idx];
+    if (idx + 1 >= argc) {
+      std::cerr << "missing value for " << arg << '\n';
+      std::exit(2);
+    }
+    const char *value = argv[++idx];
+    if (arg == "--min-bits")
+      result.min_bits = std::strtoull(value, nullptr, 10);
+    else if (arg == "--max-bits")
+      result.max_bits = std::strtoull(value, nullptr, 10);
+    else if (arg == "--min-time-ms")
+      result.min_time_ms = std::strtod(value, nullptr);
+    else if (arg == "--op")
+      result.only_op = value;
+    else {
+      std::cerr << "unknown option " << arg << '\n';
+      std::exit(2);
+    }
+  }
+  if (result.min_bits == 0)
+    result.min_bits = 1;
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const options opts = parse_options(argc, argv);
+  std::mt19937_64 rng(20240601);
+  bool first = true;
+
+  std::cout << "{\n  \"benchmark\": \"bits_bench\",\n"
+            << "  \"min_time_ms\": " << opts.min_time_ms << ",\n"
+            << "  \"results\": [";
+  for (uint64_t bit_count = opts.min_bits; bit_count <= opts.max_bits;
+       bit_count *= 2) {
+    const operands x = make_operands(rng, bit_count);
+    for (const benchmark &bench : benchmarks()) {
+      if (!opts.only_op.empty() && bench.name != opts.only_op)
+        continue;
+      if (bit_count > bench.max_bits)
+        continue;
+      if (!bench.agree(x)) {
+        std::cerr << bench.name << " disagrees with cpp_int at " << bit_count
+                  << " bits\n";
+        return 1;
+      }
+      double container_ns =
+          time_ns([&] { bench.run_container(x); }, opts.min_time_ms);
+      double cpp_int_ns =
+          time_ns([&] { bench.run_cpp_int(x); }, opts.min_time_ms);
+      std::cout << (first ? "\n" : ",\n") << "    {\"op\": \"" << bench.name
+                << "\", \"bits\": " << bit_count
+                << ", \"container_ns\": " << container_ns
+                << ", \"cpp_int_ns\": " << cpp_int_ns
+                << ", \"speedup\": " << cpp_int_ns / container_ns << "}";
+      first = false;
+    }
+  }
+  std::cout << "\n  ]\n}\n";
+}
@@ -5,7 +5,28 @@
 #include "boost/multiprecision/cpp_int.hpp"
 #include "boost/multiprecision/miller_rabin.hpp"
 #include "boost/random.hpp"
+#include "primality.hpp"
+#include "primecount.hpp"
+#include "rng.hpp"
+#include "sieve.hpp"
+#include "word.hpp"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <vector>
 
 using boost::multiprecision::cpp_int;
 using std::size_t;
@@ -13,41 +34,178 @@ using std::size_t;
 constexpr auto testIterations = 20;
 
 namespace functions {
-cpp_int mulMod(cpp_int a, cpp_int b, cpp_int m) {
-  cpp_int result{0};
-  for (; a != 0; a >>= 1) {
-    if (a & 1)
-      result = (result + b) % m;
-    b = (b << 1) % m;
-  }
+// a * b mod m in [0, m): one product and one reduction
+cpp_int mulMod(const cpp_int &a, const cpp_int &b, const cpp_int &m) {
+  cpp_int result = (a * b) % m;
+  if (result < 0)
+    result += m;
   return result;
 }
 
-cpp_int powMod(cpp_int a, cpp_int b, cpp_int m) {
-  cpp_int result = 1;
-  a %= m;
-  for (; b > 0; b >>= 1) {
-    if (b & 1)
-      result = mulMod(result, a, m);
-    a = mulMod(a, a, m);
+// Arithmetic modulo a fixed m > 0 with Barrett reduction. For
+// k = bits(m) the constant mu = floor(4^k / m) is computed once, after
+// which any x < 4^k reduces with two multiplications, two shifts and at
+// most two subtractions instead of a long division. Build it once per
+// modulus and reuse it.
+class BarrettModulus {
+private:
+  cpp_int mModulus, mFactor;
+  size_t mBits;
+
+public:
+  explicit BarrettModulus(const cpp_int &modulus) : mModulus(modulus) {
+    if (modulus <= 0)
+      throw std::invalid_argument("Modulus must be positive");
+    mBits = boost::multiprecision::msb(modulus) + 1;
+    mFactor = (cpp_int(1) << (2 * mBits)) / modulus;
   }
-  return result % m;
+
+  const cpp_int &value() const { return mModulus; }
+
+  // x mod m in [0, m) for any x; the Barrett path covers 0 <= x < 4^k,
+  // which includes every product of two reduced values
+  cpp_int reduce(const cpp_int &x) const {
+    if (x.is_zero())
+      return x;
+    if (x < 0 || boost::multiprecision::msb(x) >= 2 * mBits) {
+      cpp_int result = x % mModulus;
+      if (result < 0)
+        result += mModulus;
+      return result;
+    }
+    cpp_int result = x - (((x >> (mBits - 1)) * mFactor) >> (mBits + 1)) *
+                             mModulus;
+    while (result >= mModulus)
+      result -= mModulus;
+    return result;
+  }
+
+  // a * b mod m for a, b already in [0, m)
+  cpp_int multiply(const cpp_int &a, const cpp_int &b) const {
+    return reduce(a * b);
+  }
+
+  // base^exponent mod m by left-to-right sliding windows over a table of
+  // odd powers; a non-positive exponent gives 1 mod m
+  cpp_int pow(const cpp_int &base, const cpp_int &exponent) const {
+    if (mModulus == 1)
+      return 0;
+    if (exponent <= 0)
+      return 1;
+    const size_t exp_bits = boost::multiprecision::msb(exponent) + 1;
+    const unsigned window = bits::limbs::window_bits(exp_bits);
+
+    // table[i] = base^(2i + 1)
+    std::vector<cpp_int> table(size_t(1) << (window - 1));
+    table[0] = reduce(base);
+    const cpp_int square = multiply(table[0], table[0]);
+    for (size_t idx = 1; idx < table.size(); ++idx)
+      table[idx] = multiply(table[idx - 1], square);
+
+    cpp_int result = 1;
+    bool started = false;
+    for (int64_t pos = static_cast<int64_t>(exp_bits) - 1; pos >= 0;) {
+      if (!boost::multiprecision::bit_test(exponent, pos)) {
+        result = multiply(result, result);
+        --pos;
+        continue;
+      }
+      // Longest window ending in a set bit
+      int64_t low = std::max<int64_t>(pos - window + 1, 0);
+      while (!boost::multiprecision::bit_test(exponent, low))
+        ++low;
+      size_t value = 0;
+      for (int64_t idx = pos; idx >= low; --idx) {
+        value = (value << 1) | boost::multiprecision::bit_test(exponent, idx);
+        if (started)
+          result = multiply(result, result);
+      }
+      const cpp_int &power = table[value >> 1];
+      result = started ? multiply(result, power) : power;
+      started = true;
+      pos = low - 1;
+    }
+    return result;
+  }
+};
+
+cpp_int powMod(const cpp_int &a, const cpp_int &b, const BarrettModulus &m) {
+  return m.pow(a, b);
+}
+
+cpp_int powMod(const cpp_int &a, const cpp_int &b, const cpp_int &m) {
+  return BarrettModulus(m).pow(a, b);
 }
 
+// Deterministic and native for 64-bit numbers, probabilistic above. The
+// random bases come from this thread's engine, not boost's shared one, so
+// concurrent callers do not race.
 bool isPrime(const cpp_int &number) {
-  return boost::multiprecision::miller_rabin_test(number, testIterations);
+  if (number < 0)
+    return false;
+  if (number <= std::numeric_limits<uint64_t>::max())
+    return primality::isPrime(static_cast<uint64_t>(number));
+  return boost::multiprecision::miller_rabin_test(number, testIterations,
+                                                 rng::threadEngine());
 }
 
+// Index of the highest set bit, as boost::integer_log2 gave for builtins
 size_t bitCount(const cpp_int &number) {
-  return static_cast<size_t>(std::ceil(boost::integer_log2(number)));
+  return static_cast<size_t>(boost::multiprecision::msb(number));
 }
 
+/*
+One step of Lehmer's algorithm for a >= b >= 2^64: Euclid's steps run on
+the leading 62 bits of both numbers, as machine words, for as long as
+Knuth's test shows the quotients agree with the full numbers' ones.
+Returns the 2x2 matrix {A, B, C, D} of those steps, after which
+(A a + B b, C a + D b) is the pair Euclid would have reached. B == 0
+means not even one quotient was certain.
+*/
+std::array<int64_t, 4> lehmerMatrix(const cpp_int &a, const cpp_int &b) {
+  const size_t shift = boost::multiprecision::msb(a) + 1 - 62;
+  __int128 high_a = static_cast<uint64_t>(a >> shift);
+  __int128 high_b = static_cast<uint64_t>(b >> shift);
+  __int128 ma = 1, mb = 0, mc = 0, md = 1;
+  while (high_b + mc != 0 && high_b + md != 0) {
+    const __int128 quotient = (high_a + ma) / (high_b + mc);
+    if (quotient != (high_a + mb) / (high_b + md))
+      break;
+    __int128 t = ma - quotient * mc;
+    ma = mc;
+    mc = t;
+    t = mb - quotient * md;
+    mb = md;
+    md = t;
+    t = high_a - quotient * high_b;
+    high_a = high_b;
+    high_b = t;
+  }
+  return {static_cast<int64_t>(ma), static_cast<int64_t>(mb),
+          static_cast<int64_t>(mc), static_cast<int64_t>(md)};
+}
+
+// Lehmer's algorithm down to a single word, then plain Euclid
 cpp_int gcd(const cpp_int &a, const cpp_int &b) {
-  cpp_int first = a, second = b, tmp = 0;
+  cpp_int first = abs(a), second = abs(b), tmp = 0;
+  if (first < second)
+    std::swap(first, second);
+  while (second != 0 && boost::multiprecision::msb(second) >= 64) {
+    const auto [A, B, C, D] = lehmerMatrix(first, second);
+    if (B == 0) {
+      tmp = first % second;
+      first = std::move(second);
+      second = std::move(tmp);
+      continue;
+    }
+    tmp = A * first + B * second;
+    second = C * first + D * second;
+    first = std::move(tmp);
+  }
   while (second != 0) {
     tmp = first % second;
-    first = second;
-    second = tmp;
+    first = std::move(second);
+    second = std::move(tmp);
   }
   return first;
 }
@@ -56,22 +214,61 @@ struct cpp_int3D_t {
   cpp_int first, second, third;
 };
 
+/*
+Extended Euclid: {g, x, y} with x a + y b = g = gcd(a, b). Non-negative
+inputs go through Lehmer steps as in gcd; only the cofactor of the
+larger input is carried along, the other comes from one division at the
+end.
+*/
 cpp_int3D_t Euclid_alg(cpp_int a, cpp_int b) {
   cpp_int x = 0, y = 1, u = 1, v = 0;
   cpp_int q, m, n, r;
-  while (a != 0) {
-    q = b / a;
-    r = b % a;
-    m = x - u * q;
-    n = y - v * q;
-    b = a;
-    a = r;
-    x = u;
-    y = v;
-    u = m;
-    v = n;
+  if (a < 0 || b < 0) {
+    while (a != 0) {
+      q = b / a;
+      r = b % a;
+      m = x - u * q;
+      n = y - v * q;
+      b = a;
+      a = r;
+      x = u;
+      y = v;
+      u = m;
+      v = n;
+    }
+    return {b, x, y};
+  }
+
+  const bool swapped = a < b;
+  if (swapped)
+    std::swap(a, b);
+  const cpp_int a0 = a, b0 = b;
+  // a = u a0 and b = v a0 modulo b0
+  while (b != 0) {
+    if (boost::multiprecision::msb(b) >= 64) {
+      const auto [A, B, C, D] = lehmerMatrix(a, b);
+      if (B != 0) {
+        m = A * a + B * b;
+        b = C * a + D * b;
+        a = std::move(m);
+        m = A * u + B * v;
+        v = C * u + D * v;
+        u = std::move(m);
+        continue;
+      }
+    }
+    divide_qr(a, b, q, r);
+    a = std::move(b);
+    b = std::move(r);
+    m = u - q * v;
+    u = std::move(v);
+    v = std::move(m);
   }
-  return {b, x, y};
+  // u a0 + w b0 = a, so w is exact
+  const cpp_int w = b0 == 0 ? cpp_int(0) : (a - u * a0) / b0;
+  if (swapped)
+    return {a, w, u};
+  return {a, u, w};
 }
 
 cpp_int invMod(const cpp_int &a, const cpp_int &p) {
@@ -82,118 +279,385 @@ cpp_int invMod(const cpp_int &a, const cpp_int &p) {
   if (res.first != 1) {
     throw std::runtime_error("Modular inverse does not exist");
   }
-  cpp_int inverse = res.second;
+  cpp_int inverse = res.second % p;
   if (inverse < 0) {
     inverse += p;
   }
   return inverse;
 }
 
+// Inverses modulo p of every value by Montgomery's trick: running
+// products, one invMod of the last, then a backward sweep peeling off one
+// value at a time. N values cost one inversion and 3(N - 1) products.
+std::vector<cpp_int> batchInvMod(std::span<const cpp_int> values,
+                                 const cpp_int &p) {
+  const BarrettModulus modulus(p);
+  std::vector<cpp_int> reduced(values.size()), prefix(values.size());
+  for (size_t idx = 0; idx < values.size(); ++idx) {
+    reduced[idx] = modulus.reduce(values[idx]);
+    prefix[idx] =
+        idx ? modulus.multiply(prefix[idx - 1], reduced[idx]) : reduced[idx];
+  }
+  if (values.empty())
+    return {};
+  if (prefix.back() == 0)
+    throw std::runtime_error("Modular inverse does not exist");
+  cpp_int inverse = invMod(prefix.back(), p);
+  std::vector<cpp_int> result(values.size());
+  for (size_t idx = values.size() - 1; idx > 0; --idx) {
+    result[idx] = modulus.multiply(inverse, prefix[idx - 1]);
+    inverse = modulus.multiply(inverse, reduced[idx]);
+  }
+  result[0] = std::move(inverse);
+  return result;
+}
+
+// Value of little-endian 64-bit limbs
+cpp_int fromLimbs(std::span<const uint64_t> limbs) {
+  cpp_int result;
+  if (limbs.empty())
+    return result;
+  boost::multiprecision::import_bits(result, limbs.begin(), limbs.end(), 64,
+                                     false);
+  return result;
+}
+
+// Little-endian 64-bit limbs of |value|, none for zero
+std::vector<uint64_t> toLimbs(const cpp_int &value) {
+  std::vector<uint64_t> limbs;
+  if (!value.is_zero())
+    boost::multiprecision::export_bits(value, std::back_inserter(limbs), 64,
+                                       false);
+  return limbs;
+}
+
+// Hex digits in either case, packed sixteen to a limb from the right
 cpp_int fromHex(const std::string_view str) {
-  cpp_int result = 0;
-  for (const auto &item : str) {
+  std::vector<uint64_t> limbs((str.size() + 15) / 16);
+  for (size_t idx = 0; idx < str.size(); ++idx) {
+    const auto item = static_cast<unsigned char>(str[str.size() - 1 - idx]);
     if (!std::isxdigit(item))
       throw std::runtime_error("Given string isn't hex to dec convertable");
-    result <<= 4;
-    if (std::isdigit(item))
-      result += static_cast<int>(item - '0');
-    else
-      result += static_cast<int>(std::toupper(item) - 'A' + 10);
+    const uint64_t digit =
+        std::isdigit(item) ? item - '0' : std::toupper(item) - 'A' + 10;
+    limbs[idx / 16] |= digit << (idx % 16 * 4);
   }
+  return fromLimbs(limbs);
+}
+
+// Lowercase hex of value without leading zeros, '-' first if negative
+std::string toHex(const cpp_int &value) {
+  static constexpr char DIGITS[] = "0123456789abcdef";
+  const std::vector<uint64_t> limbs = toLimbs(value);
+  if (limbs.empty())
+    return "0";
+  std::string result(limbs.size() * 16, '0');
+  char *out = result.data() + result.size();
+  for (uint64_t limb : limbs)
+    for (int digit = 0; digit < 16; ++digit, limb >>= 4)
+      *--out = DIGITS[limb & 15];
+  result.erase(0, result.find_first_not_of('0'));
+  if (value < 0)
+    result.insert(result.begin(), '-');
+  return result;
+}
+
+// Big-endian bytes, most significant first
+cpp_int fromBytes(std::span<const uint8_t> bytes) {
+  cpp_int result;
+  if (bytes.empty())
+    return result;
+  boost::multiprecision::import_bits(result, bytes.begin(), bytes.end(), 8,
+                                     true);
   return result;
 }
+
+// Big-endian bytes of |value| without leading zeros, none for zero
+std::vector<uint8_t> toBytes(const cpp_int &value) {
+  std::vector<uint8_t> bytes;
+  if (!value.is_zero())
+    boost::multiprecision::export_bits(value, std::back_inserter(bytes), 8,
+                                       true);
+  return bytes;
+}
 } // namespace functions
 
 namespace integers {
+// bit_count random bits with the top one set, filled a limb at a time from
+// engine
+template <typename Engine>
+cpp_int getRandomBits(const size_t bit_count, Engine &engine) {
+  if (bit_count == 0)
+    return 0;
+  std::vector<uint64_t> limbs((bit_count + 63) / 64);
+  rng::fill(engine, limbs);
+  limbs.back() &= ~uint64_t(0) >> (64 - bit_count % 64) % 64;
+  limbs.back() |= uint64_t(1) << (bit_count - 1) % 64;
+  return functions::fromLimbs(limbs);
+}
+
 cpp_int getRandomBits(const size_t bit_count) {
-  boost::random::mt19937_64 genEngine{std::random_device{}()};
-  boost::random::uniform_int_distribution<int> intDistribution(0, 1);
-  cpp_int result{1};
-  for (size_t i = 0; i < bit_count - 1; ++i) {
-    result <<= 1;
-    result |= intDistribution(genEngine);
-  }
-  return result;
+  return getRandomBits(bit_count, rng::threadEngine());
+}
+
+// As getRandomBits, from the thread's ChaCha20 engine; for key material
+cpp_int getSecureRandomBits(const size_t bit_count) {
+  return getRandomBits(bit_count, rng::threadSecureEngine());
 }
 
 cpp_int getRandomInteger(size_t bit_count) { return getRandomBits(bit_count); }
 
-cpp_int getRandomInteger(cpp_int lower_bound, cpp_int upper_bound) {
-  boost::random::uniform_int_distribution<cpp_int> intDistribution(lower_bound,
-                                                                   upper_bound);
-  boost::random::mt19937_64 genEngine(std::random_device{}());
-  return intDistribution(genEngine);
+// Uniform in [lower_bound, upper_bound]: random limbs as wide as the
+// range, redrawn while they exceed it (less than half the time)
+template <typename Engine>
+cpp_int getRandomInteger(const cpp_int &lower_bound, const cpp_int &upper_bound,
+                         Engine &engine) {
+  if (lower_bound > upper_bound)
+    throw std::invalid_argument("Lower bound exceeds upper bound");
+  const cpp_int range = upper_bound - lower_bound;
+  if (range == 0)
+    return lower_bound;
+  const size_t bits = msb(range) + 1;
+  std::vector<uint64_t> limbs((bits + 63) / 64);
+  cpp_int offset;
+  do {
+    rng::fill(engine, limbs);
+    limbs.back() &= ~uint64_t(0) >> (64 - bits % 64) % 64;
+    offset = functions::fromLimbs(limbs);
+  } while (offset > range);
+  return lower_bound + offset;
+}
+
+cpp_int getRandomInteger(const cpp_int &lower_bound,
+                         const cpp_int &upper_bound) {
+  return getRandomInteger(lower_bound, upper_bound, rng::threadEngine());
+}
+
+// count numbers of bit_count bits each (top bit set), all drawn from
+// engine in one fill
+template <typename Engine>
+std::vector<cpp_int> getRandomBatch(const size_t count, const size_t bit_count,
+                                    Engine &engine) {
+  if (bit_count == 0)
+    return std::vector<cpp_int>(count);
+  const size_t width = (bit_count + 63) / 64;
+  std::vector<uint64_t> limbs(count * width);
+  rng::fill(engine, limbs);
+  std::vector<cpp_int> result;
+  result.reserve(count);
+  for (size_t idx = 0; idx < count; ++idx) {
+    std::span<uint64_t> number(limbs.data() + idx * width, width);
+    number.back() &= ~uint64_t(0) >> (64 - bit_count % 64) % 64;
+    number.back() |= uint64_t(1) << (bit_count - 1) % 64;
+    result.push_back(functions::fromLimbs(number));
+  }
+  return result;
+}
+
+std::vector<cpp_int> getRandomBatch(const size_t count,
+                                    const size_t bit_count) {
+  return getRandomBatch(count, bit_count, rng::threadEngine());
 }
 }; // namespace integers
 
 namespace primes {
 
+// Candidates are sieved by the odd primes below SIEVE_PRIME_LIMIT, a window
+// of SIEVE_WINDOW odd numbers at a time
+constexpr uint32_t SIEVE_PRIME_LIMIT = 1 << 16;
+constexpr uint64_t SIEVE_WINDOW = 1 << 12;
+
+const std::vector<uint32_t> &sievePrimes() {
+  static const std::vector<uint32_t> primes = oddPrimesUpTo(SIEVE_PRIME_LIMIT);
+  return primes;
+}
+
 /*
-Some first primes lower than 400
-We're using them to fast check is it prime cpp_int or not
+Smallest prime in [start, limit], or 0 if there is none. Below 2^64 the
+candidates go straight to the native test. Above it the residues of the
+first candidate modulo every sieve prime are computed once; each window
+of odd candidates is then sieved with word arithmetic, and only the
+survivors reach Miller-Rabin. Once *cancelled becomes true the search
+gives up and returns 0 before the next candidate.
 */
-constexpr std::array first_primes = {
-    2,   3,   5,   7,   11,  13,  17,  19,  23,  29,  31,  37,  41,
-    43,  47,  53,  59,  61,  67,  71,  73,  79,  83,  89,  97,  101,
-    103, 107, 109, 113, 127, 131, 137, 139, 149, 151, 157, 163, 167,
-    173, 179, 181, 191, 193, 197, 199, 211, 223, 227, 229, 233, 239,
-    241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311, 313,
-    317, 331, 337, 347, 349, 353, 359, 367, 373, 379, 383, 389, 397};
-
-cpp_int getLowLevelPrime(const size_t bit_count) {
-  cpp_int candidate;
-  while (true) {
-    candidate = integers::getRandomBits(bit_count) | cpp_int{1};
-    bool is_prime = true;
-    for (const auto &item : first_primes) {
-      if (candidate == item)
+cpp_int nextPrime(cpp_int start, const cpp_int &limit,
+                  const std::atomic<bool> *cancelled = nullptr) {
+  auto stopped = [cancelled] {
+    return cancelled && cancelled->load(std::memory_order_relaxed);
+  };
+  constexpr uint64_t NATIVE_LIMIT = std::numeric_limits<uint64_t>::max();
+  if (start < 2)
+    start = 2;
+  if (start <= NATIVE_LIMIT) {
+    const uint64_t last = limit < NATIVE_LIMIT
+                              ? static_cast<uint64_t>(limit)
+                              : NATIVE_LIMIT;
+    for (uint64_t candidate = static_cast<uint64_t>(start);
+         candidate <= last && candidate >= start; ++candidate) {
+      if (stopped())
+        return 0;
+      if (primality::isPrime(candidate))
         return candidate;
-      else if (candidate % item == 0) {
-        is_prime = false;
-        break;
-      }
     }
-    if (is_prime)
-      return candidate;
+    if (limit <= NATIVE_LIMIT)
+      return 0;
+    start = cpp_int(NATIVE_LIMIT) + 1;
   }
-}
+  start |= 1;
 
-cpp_int getLowLevelPrime(const cpp_int &lower_bound,
-                         const cpp_int &upper_bound) {
-  cpp_int candidate;
-  while (true) {
-    candidate = integers::getRandomInteger(lower_bound, upper_bound) | 1;
-    bool is_prime = true;
-    for (const auto &item : first_primes) {
-      if (candidate == item)
+  // Every candidate is above 2^64, so none of them is a sieve prime
+  const std::vector<uint32_t> &primes = sievePrimes();
+  std::vector<uint32_t> residues(primes.size());
+  for (size_t idx = 0; idx < primes.size(); ++idx)
+    residues[idx] = static_cast<uint32_t>(start % primes[idx]);
+
+  std::vector<uint8_t> composite(SIEVE_WINDOW);
+  for (cpp_int base = start; base <= limit; base += 2 * SIEVE_WINDOW) {
+    std::fill(composite.begin(), composite.end(), 0);
+    for (size_t idx = 0; idx < primes.size(); ++idx) {
+      // base + 2k = 0 (mod p) for k = -residue / 2 (mod p)
+      const uint64_t prime = primes[idx];
+      uint64_t offset = (prime - residues[idx]) % prime * ((prime + 1) / 2) %
+                        prime;
+      for (; offset < SIEVE_WINDOW; offset += prime)
+        composite[offset] = 1;
+      residues[idx] = static_cast<uint32_t>(
+          (residues[idx] + 2 * SIEVE_WINDOW % prime) % prime);
+    }
+    for (uint64_t offset = 0; offset < SIEVE_WINDOW; ++offset) {
+      if (composite[offset])
+        continue;
+      cpp_int candidate = base + 2 * offset;
+      if (candidate > limit || stopped())
+        return 0;
+      // One base-2 Fermat test turns away nearly every composite survivor
+      // before the full set of Miller-Rabin rounds
+      if (functions::powMod(2, candidate - 1, candidate) == 1 &&
+          functions::isPrime(candidate))
         return candidate;
-      else if (candidate % item == 0) {
-        is_prime = false;
-        break;
-      }
     }
-    if (is_prime)
-      return candidate;
   }
+  return 0;
 }
 
 cpp_int getRandomPrime(const size_t bit_count) {
-  cpp_int candidate;
+  if (bit_count < 2)
+    throw std::invalid_argument("There are no primes below 2 bits");
+  const cpp_int limit = (cpp_int(1) << bit_count) - 1;
   while (true) {
-    candidate = getLowLevelPrime(bit_count);
-    if (functions::isPrime(candidate))
-      return candidate;
+    // Top bit set, so the prime keeps the requested size
+    cpp_int prime = nextPrime(integers::getSecureRandomBits(bit_count), limit);
+    if (prime != 0)
+      return prime;
   }
 }
 
 cpp_int getRandomPrime(const cpp_int &lower_bound, const cpp_int &upper_bound) {
-  cpp_int candidate;
-  while (true) {
-    candidate = getLowLevelPrime(lower_bound, upper_bound);
-    if (functions::isPrime(candidate))
-      return candidate;
-  }
+  if (lower_bound > upper_bound)
+    throw std::invalid_argument("Lower bound exceeds upper bound");
+  // Search up from a random start, wrapping around to lower_bound once
+  const cpp_int start = integers::getRandomInteger(
+      lower_bound, upper_bound, rng::threadSecureEngine());
+  cpp_int prime = nextPrime(start, upper_bound);
+  if (prime == 0)
+    prime = nextPrime(lower_bound, start);
+  if (prime == 0)
+    throw std::runtime_error("There is no prime in the given range");
+  return prime;
 }
+
+/*
+Finds several random primes of one size at once. Every worker of a
+thread pool runs its own sieved search from its own random start; the
+first distinct primes found are kept, and as soon as there are enough
+all the other searches are called off at their next candidate.
+
+threads == 0 uses every hardware thread. Each worker draws from its own
+ChaCha20 engine; with a seed those engines are keyed from (seed, worker),
+so a seeded single-thread generator always returns the same primes.
+Without one they are keyed from std::random_device.
+*/
+class PrimeGenerator {
+private:
+  unsigned mThreads;
+  std::optional<uint64_t> mSeed;
+
+  rng::chacha20 makeEngine(uint32_t worker) const {
+    if (!mSeed)
+      return rng::chacha20();
+    std::seed_seq sequence{uint32_t(*mSeed), uint32_t(*mSeed >> 32), worker};
+    return rng::chacha20(sequence);
+  }
+
+  // Every size has at least two primes, and every size from 32 bits on
+  // more than the 98,182,656 of 32 bits
+  static constexpr uint64_t PRIMES_OF_32_BITS = 98182656;
+
+  // How many primes have exactly bit_count bits. Past 40 bits there are
+  // over 2 * 10^10, more than any result could hold, so the count is
+  // capped there instead of computed.
+  static uint64_t availablePrimes(const size_t bit_count) {
+    if (bit_count > 40)
+      return std::numeric_limits<uint64_t>::max();
+    const uint64_t top = uint64_t(1) << (bit_count - 1);
+    return primePi(2 * top - 1) - primePi(top - 1);
+  }
+
+public:
+  explicit PrimeGenerator(unsigned threads = 0,
+                          std::optional<uint64_t> seed = std::nullopt)
+      : mThreads(threads ? threads : parallel::defaultThreads()),
+        mSeed(seed) {}
+
+  [[nodiscard]] unsigned threads() const { return mThreads; }
+
+  // count distinct primes with exactly bit_count bits. A stop request on
+  // stop ends the search early with std::runtime_error.
+  std::vector<cpp_int> generate(const size_t bit_count, const size_t count,
+                                std::stop_token stop = {}) const {
+    if (bit_count < 2)
+      throw std::invalid_argument("There are no primes below 2 bits");
+    if (count > 2 && (bit_count < 32 || count > PRIMES_OF_32_BITS) &&
+        count > availablePrimes(bit_count))
+      throw std::invalid_argument("Too few primes of that size");
+    const cpp_int limit = (cpp_int(1) << bit_count) - 1;
+    std::vector<cpp_int> found;
+    std::mutex found_mutex;
+    std::atomic<bool> done{count == 0};
+    std::stop_callback on_stop(stop, [&done] { done.store(true); });
+
+    parallel::threadPool pool(mThreads);
+    pool.forEach(pool.size(), [&](unsigned, uint32_t worker) {
+      rng::chacha20 engine = makeEngine(worker);
+      while (!done.load(std::memory_order_relaxed)) {
+        cpp_int prime =
+            nextPrime(integers::getRandomBits(bit_count, engine), limit, &done);
+        if (prime == 0)
+          continue;
+        std::lock_guard lock(found_mutex);
+        if (found.size() < count &&
+            std::find(found.begin(), found.end(), prime) == found.end())
+          found.push_back(prime);
+        if (found.size() == count)
+          done.store(true);
+      }
+    });
+    if (found.size() < count)
+      throw std::runtime_error("Prime generation was cancelled");
+    return found;
+  }
+
+  // generate() on a thread of its own
+  std::future<std::vector<cpp_int>> generateAsync(const size_t bit_count,
+                                                  const size_t count,
+                                                  std::stop_token stop = {})
+      const {
+    return std::async(std::launch::async,
+                      [generator = *this, bit_count, count, stop] {
+                        return generator.generate(bit_count, count, stop);
+                      });
+  }
+};
 } // namespace primes
 
 #endif // !RANDOM_INTEGER_H
@@ -3,17 +3,21 @@
 #define CLAMPED_BITS_HPP
 
 #include <algorithm>
+#include <bit>
 #include <cmath>
 #include <concepts>
 #include <cstdint>
 #include <cstring>
 #include <limits>
-#include <memory>
 #include <ostream>
 #include <ranges>
-#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "limbs.hpp"
 
 namespace bits {
 
@@ -56,40 +60,135 @@ uint64_t bitlen(std::unsigned_integral auto number) {
   return static_cast<uint64_t>(std::ceil(std::log2(number))) + 1;
 }
 
+// Digits of `base` that fit in one limb: the largest power base^digits
+// that does not overflow uint64_t
+struct radix_chunk_t {
+  uint64_t digits;
+  uint64_t power;
+};
+
+inline radix_chunk_t radix_chunk(unsigned int base) {
+  radix_chunk_t chunk{1, base};
+  while (chunk.power <= ONES / base) {
+    chunk.power *= base;
+    ++chunk.digits;
+  }
+  return chunk;
+}
+
+// Value of a digit character in bases up to 36, or 36 when invalid
+inline unsigned int digit_value(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'z')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'Z')
+    return c - 'A' + 10;
+  return 36;
+}
+
+constexpr char DIGITS[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
 } // namespace detail
 
+// Number of limbs stored inside the container before spilling to the heap
+#ifndef BITS_INLINE_BLOCKS
+#define BITS_INLINE_BLOCKS 4
+#endif
+
 class container {
 private:
+  static constexpr uint64_t INLINE_BLOCKS = BITS_INLINE_BLOCKS;
+  static_assert(INLINE_BLOCKS >= 1, "At least one inline block is required");
+
   uint64_t mSize;
   uint64_t mBlocks;
-  std::unique_ptr<uint64_t[]> mData;
-
-  static void trim(container &bits) {
-    if (bits.mSize <= 1)
-      return;
-
-    uint64_t count_top_zeros = 0;
-    for (int64_t bit_idx = bits.mSize - 1; bit_idx >= 0 && !bits[bit_idx];
-         --bit_idx) {
-      count_top_zeros++;
+  uint64_t mCapacity; // Blocks available at mData, never below mBlocks
+  uint64_t *mData;    // Points at mInline or at a heap block
+  uint64_t mInline[INLINE_BLOCKS];
+
+  [[nodiscard]] bool is_inline() const { return mData == mInline; }
+
+  // Points mData at storage for at least the given number of blocks,
+  // contents are left uninitialized
+  void allocate(uint64_t blocks) {
+    if (blocks <= INLINE_BLOCKS) {
+      mData = mInline;
+      mCapacity = INLINE_BLOCKS;
+    } else {
+      mData = new uint64_t[blocks];
+      mCapacity = blocks;
     }
+  }
 
-    if (count_top_zeros == 0)
-      return;
-
-    uint64_t new_size = bits.mSize - count_top_zeros;
-    uint64_t new_blocks = detail::calculate_blocks(new_size);
+  void release() {
+    if (!is_inline())
+      delete[] mData;
+    mData = mInline;
+    mCapacity = INLINE_BLOCKS;
+  }
 
-    if (new_blocks == bits.mBlocks) {
-      bits.mSize = new_size;
+  // Moves the current blocks into storage for exactly `capacity` blocks
+  // (or the inline buffer when they fit), capacity must be >= mBlocks
+  void set_capacity(uint64_t capacity) {
+    if (capacity <= INLINE_BLOCKS) {
+      if (!is_inline()) {
+        std::copy_n(mData, mBlocks, mInline);
+        release();
+      }
       return;
     }
+    uint64_t *new_data = new uint64_t[capacity];
+    std::copy_n(mData, mBlocks, new_data);
+    release();
+    mData = new_data;
+    mCapacity = capacity;
+  }
+
+  // Sets the number of used blocks, zero filling newly exposed ones and
+  // growing the storage geometrically when needed. Never shrinks storage.
+  void resize_blocks(uint64_t blocks) {
+    if (blocks > mCapacity)
+      set_capacity(std::max(blocks, mCapacity * 2));
+    if (blocks > mBlocks)
+      std::fill(mData + mBlocks, mData + blocks, 0);
+    mBlocks = blocks;
+  }
+
+  // Clears the bits of the top block that lie above mSize
+  void clear_tail() {
+    if (mSize % 64 != 0 && mBlocks > 0)
+      mData[mBlocks - 1] &= detail::ONES >> (64 - mSize % 64);
+  }
+
+  // Takes over the storage of other, leaving it holding zero
+  void steal(container &other) noexcept {
+    mSize = other.mSize;
+    mBlocks = other.mBlocks;
+    mCapacity = other.mCapacity;
+    if (other.is_inline()) {
+      mData = mInline;
+      std::copy_n(other.mInline, mBlocks, mInline);
+    } else {
+      mData = other.mData;
+    }
+    other.mSize = 1;
+    other.mBlocks = 1;
+    other.mCapacity = INLINE_BLOCKS;
+    other.mData = other.mInline;
+    other.mInline[0] = 0;
+  }
 
-    auto new_data = std::make_unique<uint64_t[]>(new_blocks);
-    std::copy_n(bits.mData.get(), new_blocks, new_data.get());
-    bits.mBlocks = new_blocks;
-    bits.mSize = new_size;
-    bits.mData = std::move(new_data);
+  // Drops leading zero bits, keeping the storage. Zero keeps a single bit.
+  static void trim(container &bits) {
+    uint64_t blocks = limbs::normalize(bits.mData, bits.mBlocks);
+    if (blocks == 0) {
+      bits.resize_blocks(1);
+      bits.mSize = 1;
+      return;
+    }
+    bits.mBlocks = blocks;
+    bits.mSize = (blocks - 1) * 64 + std::bit_width(bits.mData[blocks - 1]);
   }
 
   static void shift_left_blocks(uint64_t *data, uint64_t blocks,
@@ -112,23 +211,133 @@ private:
     std::fill_n(data + (blocks - shift_blocks), shift_blocks, 0);
   }
 
+  // Either output may be null or alias the dividend
+  static void divide(const container &dividend, const container &divisor,
+                     container *quotient, container *remainder) {
+    uint64_t divisor_blocks =
+        limbs::normalize(divisor.mData, divisor.mBlocks);
+    if (divisor_blocks == 0) {
+      throw std::invalid_argument("Division by zero");
+    }
+    uint64_t dividend_blocks =
+        limbs::normalize(dividend.mData, dividend.mBlocks);
+
+    if (dividend < divisor) {
+      if (remainder && remainder != &dividend)
+        *remainder = dividend;
+      if (quotient)
+        *quotient = container(1, 0);
+      return;
+    }
+
+    container q((dividend_blocks - divisor_blocks + 1) * 64, 0);
+    container r(divisor_blocks * 64, 0);
+    limbs::divmod(q.mData, r.mData, dividend.mData,
+                  dividend_blocks, divisor.mData, divisor_blocks);
+    trim(q);
+    trim(r);
+    if (quotient)
+      *quotient = std::move(q);
+    if (remainder)
+      *remainder = std::move(r);
+  }
+
+  // Operands below this many blocks are converted by repeated division
+  static constexpr uint64_t RADIX_BASECASE_BLOCKS = 32;
+
+  std::string convert_to_power_of_two_base(unsigned int base) const {
+    const unsigned digit_bits = std::countr_zero(base);
+    const uint64_t bit_count = limbs::normalize(mData, mBlocks) * 64;
+    std::string result((bit_count + digit_bits - 1) / digit_bits, '0');
+    char *out = result.data() + result.size();
+    for (uint64_t bit = 0; bit < bit_count; bit += digit_bits) {
+      uint64_t value = mData[bit / 64] >> (bit % 64);
+      if (bit % 64 + digit_bits > 64 && bit / 64 + 1 < mBlocks)
+        value |= mData[bit / 64 + 1] << (64 - bit % 64);
+      *--out = detail::DIGITS[value & (base - 1)];
+    }
+    return result;
+  }
+
+  // Writes exactly chunk.digits * 2^level digits of num (which must be
+  // below powers[level]) ending at `end`, zero padded on the left.
+  // Consumes num.
+  static void write_digits(container &num,
+                           const std::vector<container> &powers,
+                           uint64_t level, detail::radix_chunk_t chunk,
+                           unsigned int base, char *end) {
+    if (level == 0 || num.mBlocks <= RADIX_BASECASE_BLOCKS) {
+      char *begin = end - (chunk.digits << level);
+      uint64_t blocks = limbs::normalize(num.mData, num.mBlocks);
+      while (blocks > 0) {
+        uint64_t part = limbs::divmod_1(num.mData, num.mData, blocks,
+                                        chunk.power);
+        blocks = limbs::normalize(num.mData, blocks);
+        for (uint64_t digit = 0; digit < chunk.digits; ++digit) {
+          *--end = detail::DIGITS[part % base];
+          part /= base;
+        }
+      }
+      std::fill(begin, end, '0');
+      return;
+    }
+    auto [high, low] = divmod(num, powers[level - 1]);
+    write_digits(low, powers, level - 1, chunk, base, end);
+    write_digits(high, powers, level - 1, chunk, base,
+                 end - (chunk.digits << (level - 1)));
+  }
+
+  // Combines `count` limb-sized chunks (most significant first) into
+  // result, splitting off power-of-two sized low halves
+  static void read_chunks(container &result, const uint64_t *chunks,
+                          uint64_t count, std::vector<container> &powers,
+                          uint64_t chunk_power) {
+    if (count <= RADIX_BASECASE_BLOCKS) {
+      result = container(count * 64 + 64, 0);
+      uint64_t blocks = 0;
+      for (uint64_t idx = 0; idx < count; ++idx) {
+        uint64_t carry = limbs::mul_1(result.mData, result.mData, blocks,
+                                      chunk_power);
+        if (carry)
+          result.mData[blocks++] = carry;
+        carry = limbs::add_1(result.mData, result.mData, blocks, chunks[idx]);
+        if (carry)
+          result.mData[blocks++] = carry;
+      }
+      trim(result);
+      return;
+    }
+    uint64_t level = std::bit_width(count - 1) - 1;
+    uint64_t low_count = 1ull << level;
+    while (powers.size() <= level)
+      powers.push_back(powers.back().square());
+    container low(1, 0);
+    read_chunks(result, chunks, count - low_count, powers, chunk_power);
+    read_chunks(low, chunks + count - low_count, low_count, powers,
+                chunk_power);
+    result *= powers[level];
+    result += low;
+  }
+
 public:
   // Constructors
   explicit container(uint64_t bit_count, unsigned int filler)
-      : mSize(bit_count), mBlocks(detail::calculate_blocks(bit_count)),
-        mData(std::make_unique<uint64_t[]>(mBlocks)) {
-    std::fill_n(mData.get(), mBlocks, filler ? detail::ONES : 0);
+      : mSize(bit_count), mBlocks(detail::calculate_blocks(bit_count)) {
+    allocate(mBlocks);
+    std::fill_n(mData, mBlocks, filler ? detail::ONES : 0);
+    clear_tail();
   }
 
-  container(const char *binary_string) : mSize(0), mBlocks(0), mData(nullptr) {
+  container(const char *binary_string)
+      : mSize(0), mBlocks(0), mCapacity(INLINE_BLOCKS), mData(mInline) {
     if (!binary_string || !detail::is_binary_str(binary_string)) {
       throw std::invalid_argument("Invalid binary string");
     }
 
     mSize = std::strlen(binary_string);
     mBlocks = detail::calculate_blocks(mSize);
-    mData = std::make_unique<uint64_t[]>(mBlocks);
-    std::fill_n(mData.get(), mBlocks, 0);
+    allocate(mBlocks);
+    std::fill_n(mData, mBlocks, 0);
 
     for (uint64_t idx = 0; idx < mSize; ++idx) {
       if (binary_string[mSize - idx - 1] == '1') {
@@ -137,6 +346,53 @@ public:
     }
   }
 
+  // Parses digits in the given base (2 to 36), letters in either case
+  container(std::string_view digits, unsigned int base)
+      : container(1, 0) {
+    if (base < 2 || base > 36) {
+      throw std::invalid_argument("Base must be between 2 and 36");
+    }
+    auto is_digit = [base](char c) { return detail::digit_value(c) < base; };
+    if (digits.empty() ||
+        !std::all_of(digits.begin(), digits.end(), is_digit)) {
+      throw std::invalid_argument("Invalid digit string for the given base");
+    }
+
+    if (std::has_single_bit(base)) {
+      const unsigned digit_bits = std::countr_zero(base);
+      mSize = digits.size() * digit_bits;
+      resize_blocks(detail::calculate_blocks(mSize));
+      uint64_t bit = 0;
+      for (auto it = digits.rbegin(); it != digits.rend(); ++it) {
+        uint64_t value = detail::digit_value(*it);
+        mData[bit / 64] |= value << (bit % 64);
+        if (bit % 64 + digit_bits > 64)
+          mData[bit / 64 + 1] |= value >> (64 - bit % 64);
+        bit += digit_bits;
+      }
+      trim(*this);
+      return;
+    }
+
+    // Cut the digits into limb-sized chunks, the first one may be short
+    const detail::radix_chunk_t chunk = detail::radix_chunk(base);
+    std::vector<uint64_t> chunks;
+    chunks.reserve(digits.size() / chunk.digits + 1);
+    uint64_t first = digits.size() % chunk.digits;
+    if (first == 0)
+      first = chunk.digits;
+    for (uint64_t pos = 0, len = first; pos < digits.size();
+         pos += len, len = chunk.digits) {
+      uint64_t value = 0;
+      for (uint64_t idx = pos; idx < pos + len; ++idx)
+        value = value * base + detail::digit_value(digits[idx]);
+      chunks.push_back(value);
+    }
+
+    std::vector<container> powers{container(chunk.power)};
+    read_chunks(*this, chunks.data(), chunks.size(), powers, chunk.power);
+  }
+
   container(std::integral auto bits_data)
       : container(detail::bitlen(bits_data), 0) {
     mData[0] = bits_data;
@@ -144,26 +400,46 @@ public:
 
   // Copy and move
   container(const container &other)
-      : mSize(other.mSize), mBlocks(other.mBlocks),
-        mData(std::make_unique<uint64_t[]>(mBlocks)) {
-    std::copy_n(other.mData.get(), mBlocks, mData.get());
+      : mSize(other.mSize), mBlocks(other.mBlocks) {
+    allocate(mBlocks);
+    std::copy_n(other.mData, mBlocks, mData);
   }
 
-  container(container &&) noexcept = default;
+  container(container &&other) noexcept { steal(other); }
+
+  ~container() { release(); }
 
   container &operator=(const container &other) {
     if (this != &other) {
-      container temp(other);
-      swap(temp);
+      if (other.mBlocks > mCapacity) {
+        release();
+        allocate(other.mBlocks);
+      }
+      mSize = other.mSize;
+      mBlocks = other.mBlocks;
+      std::copy_n(other.mData, mBlocks, mData);
+    }
+    return *this;
+  }
+  container &operator=(container &&other) noexcept {
+    if (this == &other)
+      return *this;
+    // Small values are copied so our own storage stays warm
+    if (other.is_inline() && other.mBlocks <= mCapacity) {
+      mSize = other.mSize;
+      mBlocks = other.mBlocks;
+      std::copy_n(other.mData, mBlocks, mData);
+      return *this;
     }
+    release();
+    steal(other);
     return *this;
   }
-  container &operator=(container &&) noexcept = default;
 
   void swap(container &other) noexcept {
-    std::swap(mSize, other.mSize);
-    std::swap(mBlocks, other.mBlocks);
-    mData.swap(other.mData);
+    container temp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(temp);
   }
 
   // Utility methods
@@ -171,21 +447,11 @@ public:
   // Compare operators
   friend std::strong_ordering operator<=>(const container &lhs,
                                           const container &rhs) {
-    uint64_t max_blocks = std::max(lhs.mBlocks, rhs.mBlocks);
-    uint64_t left = 0, right = 0;
-    for (int64_t block_idx = max_blocks - 1; block_idx >= 0; block_idx -= 1) {
-      left = static_cast<uint64_t>(block_idx) < lhs.mBlocks
-                 ? lhs.mData[block_idx]
-                 : 0;
-      right = static_cast<uint64_t>(block_idx) < rhs.mBlocks
-                  ? rhs.mData[block_idx]
-                  : 0;
-      if (left < right)
-        return std::strong_ordering::less;
-      if (left > right)
-        return std::strong_ordering::greater;
-    }
-    return std::strong_ordering::equal;
+    uint64_t left = limbs::normalize(lhs.mData, lhs.mBlocks);
+    uint64_t right = limbs::normalize(rhs.mData, rhs.mBlocks);
+    if (left != right)
+      return left <=> right;
+    return limbs::cmp(lhs.mData, rhs.mData, left) <=> 0;
   }
 
   friend bool operator==(const container &lhs, const container &rhs) {
@@ -196,7 +462,9 @@ public:
   }
 
   friend bool operator==(const container &lhs, std::integral auto rhs) {
-    return lhs == container(rhs);
+    uint64_t blocks = limbs::normalize(lhs.mData, lhs.mBlocks);
+    uint64_t value = static_cast<uint64_t>(rhs);
+    return blocks == 0 ? value == 0 : blocks == 1 && lhs.mData[0] == value;
   }
   friend bool operator!=(const container &lhs, std::integral auto rhs) {
     return !(lhs == rhs);
@@ -226,151 +494,151 @@ public:
   container &operator+=(const container &other) {
     uint64_t max_size = std::max(mSize, other.mSize) + 1;
     expand(max_size);
-
-    uint64_t carry = 0;
-    for (uint64_t block_idx = 0; block_idx < mBlocks; ++block_idx) {
-      __uint128_t sum =
-          static_cast<__uint128_t>(mData[block_idx]) +
-          (block_idx < other.mBlocks ? other.mData[block_idx] : 0) + carry;
-      mData[block_idx] = static_cast<uint64_t>(sum);
-      carry = static_cast<uint64_t>(sum >> 64);
-    }
-
+    // The extra bit guarantees the final carry lands inside mBlocks
+    limbs::add(mData, mData, mBlocks, other.mData, other.mBlocks);
     trim(*this);
     return *this;
   }
 
+  // Saturating: subtracting a larger value gives zero
   container &operator-=(const container &other) {
-    if (*this < other)
-      *this = container(1, 0); // Устанавливаем ноль
-    uint64_t borrow = 0, left = 0, right = 0;
-    for (uint64_t block_idx = 0; block_idx < mBlocks; ++block_idx) {
-      left = mData[block_idx];
-      right = block_idx < other.mBlocks ? other.mData[block_idx] : 0;
-      __int128 temp = static_cast<__uint128_t>(left) - right - borrow;
-      if (temp < 0) {
-        mData[block_idx] = static_cast<uint64_t>(temp + (__int128_t(1) << 64));
-        borrow = 1;
-      } else {
-        mData[block_idx] = static_cast<uint64_t>(temp);
-        borrow = 0;
-      }
+    if (*this <= other) {
+      mSize = 1;
+      mBlocks = 1;
+      mData[0] = 0;
+      return *this;
     }
-    container::trim(*this);
+    uint64_t other_blocks = limbs::normalize(other.mData, other.mBlocks);
+    limbs::sub(mData, mData, mBlocks, other.mData, other_blocks);
+    trim(*this);
     return *this;
   }
 
   container &operator*=(const container &other) {
-    if (*this == 0ull || other == 0ull) {
+    uint64_t left_blocks = limbs::normalize(mData, mBlocks);
+    uint64_t right_blocks = limbs::normalize(other.mData, other.mBlocks);
+    if (left_blocks == 0 || right_blocks == 0) {
       *this = container(1, 0);
       return *this;
     }
-    container result(mSize + other.mSize, 0);
-    {
-      container temp(*this);
-      for (uint64_t i = 0; i < other.mSize; ++i) {
-        if (other[i])
-          result += temp;
-        temp <<= 1;
-      }
-    }
+    container result((left_blocks + right_blocks) * 64, 0);
+    limbs::mul(result.mData, mData, left_blocks,
+               other.mData, right_blocks);
     *this = std::move(result);
     trim(*this);
     return *this;
   }
 
-  container &operator/=(const container &divisor) {
-    if (divisor == 0ull) {
-      throw std::invalid_argument("Division by zero");
-    }
-
-    if (*this < divisor) {
-      *this = container(1, 0);
-      return *this;
-    }
-
-    container quotient(mSize, 0);
-    container remainder(*this);
-    container temp_divisor(divisor);
-
-    // Нормализация делителя
-    int shift = mSize - temp_divisor.mSize;
-    temp_divisor <<= shift;
-
-    // Пока остаток больше или равен исходному делителю
-    while (shift >= 0) {
-      if (remainder >= temp_divisor) {
-        remainder -= temp_divisor;
-        quotient.set(shift, 1);
-      }
-      temp_divisor >>= 1;
-      --shift;
-    }
+  [[nodiscard]] container square() const {
+    uint64_t blocks = limbs::normalize(mData, mBlocks);
+    if (blocks == 0)
+      return container(1, 0);
+    container result(blocks * 128, 0);
+    limbs::sqr(result.mData, mData, blocks);
+    trim(result);
+    return result;
+  }
 
-    *this = std::move(quotient);
-    trim(*this);
+  container &operator/=(const container &divisor) {
+    divide(*this, divisor, this, nullptr);
     return *this;
   }
 
   container &operator%=(const container &divisor) {
-    if (divisor == 0ull) {
-      throw std::invalid_argument("Division by zero");
-    }
-
-    if (*this < divisor) {
-      return *this;
-    }
-
-    container temp_divisor(divisor);
-
-    // Нормализация делителя
-    int shift = mSize - temp_divisor.mSize;
-    temp_divisor <<= shift;
-
-    // Пока остаток больше или равен исходному делителю
-    while (shift >= 0) {
-      if (*this >= temp_divisor) {
-        *this -= temp_divisor;
-      }
-      temp_divisor >>= 1;
-      --shift;
-    }
-
-    trim(*this);
+    divide(*this, divisor, nullptr, this);
     return *this;
   }
 
+  // Quotient and remainder in a single pass
+  friend std::pair<container, container> divmod(const container &dividend,
+                                                const container &divisor) {
+    container quotient(1, 0), remainder(1, 0);
+    divide(dividend, divisor, &quotient, &remainder);
+    return {std::move(quotient), std::move(remainder)};
+  }
+
   // Utility methods
   void expand(uint64_t new_size, unsigned int filler = 0) {
     if (new_size <= mSize)
       return;
 
-    uint64_t new_blocks = detail::calculate_blocks(new_size);
-    if (new_blocks == mBlocks) {
-      mSize = new_size;
-      return;
-    }
-
-    auto new_data = std::make_unique<uint64_t[]>(new_blocks);
-    std::copy_n(mData.get(), mBlocks, new_data.get());
+    uint64_t old_size = mSize;
+    clear_tail();
+    resize_blocks(detail::calculate_blocks(new_size));
+    mSize = new_size;
 
     if (filler) {
-      std::fill_n(new_data.get() + mBlocks, new_blocks - mBlocks, detail::ONES);
-      // Fix the last partial block in the original data if necessary
-      if (mSize % 64 != 0) {
-        new_data[mBlocks - 1] |= detail::ONES << (mSize % 64);
-      }
-    } else {
-      std::fill_n(new_data.get() + mBlocks, new_blocks - mBlocks, 0);
+      uint64_t first_full = detail::calculate_blocks(old_size);
+      if (old_size % 64 != 0)
+        mData[old_size / 64] |= detail::ONES << (old_size % 64);
+      std::fill(mData + first_full, mData + mBlocks, detail::ONES);
+      clear_tail();
     }
+  }
 
-    mData = std::move(new_data);
-    mBlocks = new_blocks;
-    mSize = new_size;
+  // Makes room for bit_count bits without changing the value
+  void reserve(uint64_t bit_count) {
+    uint64_t blocks = detail::calculate_blocks(bit_count);
+    if (blocks > mCapacity)
+      set_capacity(blocks);
+  }
+
+  void shrink_to_fit() {
+    if (mCapacity > mBlocks)
+      set_capacity(mBlocks);
   }
 
+  [[nodiscard]] uint64_t capacity() const { return mCapacity * 64; }
+
   [[nodiscard]] uint64_t size() const { return mSize; }
 
+  // Raw little-endian limbs, blocks() of them
+  [[nodiscard]] const uint64_t *data() const { return mData; }
+  [[nodiscard]] uint64_t blocks() const { return mBlocks; }
+
+  static container from_blocks(const uint64_t *blocks, uint64_t count) {
+    container result(count * 64, 0);
+    std::copy_n(blocks, count, result.mData);
+    trim(result);
+    return result;
+  }
+
+  // Big-endian bytes, most significant first, packed eight to a block
+  static container from_bytes(const uint8_t *bytes, uint64_t count) {
+    container result(std::max<uint64_t>(count * 8, 1), 0);
+    for (uint64_t idx = 0; idx < count; ++idx)
+      result.mData[idx / 8] |= uint64_t(bytes[count - 1 - idx])
+                               << (idx % 8 * 8);
+    trim(result);
+    return result;
+  }
+
+  // Big-endian bytes without leading zeros, none for zero
+  [[nodiscard]] std::vector<uint8_t> to_bytes() const {
+    const uint64_t blocks = limbs::normalize(mData, mBlocks);
+    if (blocks == 0)
+      return {};
+    const uint64_t count =
+        (blocks - 1) * 8 + (std::bit_width(mData[blocks - 1]) + 7) / 8;
+    std::vector<uint8_t> bytes(count);
+    for (uint64_t idx = 0; idx < count; ++idx)
+      bytes[count - 1 - idx] =
+          static_cast<uint8_t>(mData[idx / 8] >> (idx % 8 * 8));
+    return bytes;
+  }
+
+  // Uniformly random value below 2^bit_count, one engine() call per limb;
+  // engine must produce full 64-bit words
+  template <typename Engine>
+  static container random(uint64_t bit_count, Engine &engine) {
+    container result(bit_count, 0);
+    for (uint64_t idx = 0; idx < result.mBlocks; ++idx)
+      result.mData[idx] = static_cast<uint64_t>(engine());
+    result.clear_tail();
+    trim(result);
+    return result;
+  }
+
   void set(uint64_t position, unsigned int bit) {
     if (position >= mSize)
       return;
@@ -389,6 +657,7 @@ public:
     auto new_block = (bit) ? detail::ONES : 0;
     for (uint64_t block_idx = 0; block_idx < mBlocks; ++block_idx)
       mData[block_idx] = new_block;
+    clear_tail();
   }
   // Bits manip
   container operator<<(uint64_t count) const {
@@ -409,7 +678,7 @@ public:
 
     // Only full blocks shift
     if (bit_shift == 0) {
-      std::copy_n(mData.get(), mBlocks, result.mData.get() + block_shift);
+      std::copy_n(mData, mBlocks, result.mData + block_shift);
       return result;
     }
 
@@ -440,7 +709,7 @@ public:
     uint64_t bit_shift = count % 64;
 
     if (bit_shift == 0) {
-      std::copy_n(mData.get() + block_shift, new_blocks, result.mData.get());
+      std::copy_n(mData + block_shift, new_blocks, result.mData);
       return result;
     }
 
@@ -458,46 +727,87 @@ public:
   }
 
   container &operator<<=(uint64_t count) {
-    *this = *this << count;
+    if (count == 0)
+      return *this;
+    if (count >= std::numeric_limits<uint64_t>::max() - mSize) {
+      throw std::overflow_error("Shift would cause overflow");
+    }
+    uint64_t old_blocks = mBlocks;
+    uint64_t block_shift = count / 64;
+    unsigned bit_shift = count % 64;
+    resize_blocks(detail::calculate_blocks(mSize + count));
+    mSize += count;
+
+    // Walk down so every source block is read before it is overwritten
+    for (uint64_t idx = mBlocks; idx-- > block_shift;) {
+      uint64_t src = idx - block_shift;
+      uint64_t high = src < old_blocks ? mData[src] : 0;
+      uint64_t low = src > 0 && src - 1 < old_blocks ? mData[src - 1] : 0;
+      mData[idx] = bit_shift ? (high << bit_shift) | (low >> (64 - bit_shift))
+                             : high;
+    }
+    std::fill_n(mData, std::min(block_shift, mBlocks), 0);
     return *this;
   }
 
   container &operator>>=(uint64_t count) {
-    *this = *this >> count;
+    if (count == 0)
+      return *this;
+    if (count >= mSize) {
+      mSize = 1;
+      mBlocks = 1;
+      mData[0] = 0;
+      return *this;
+    }
+    uint64_t new_size = mSize - count;
+    uint64_t new_blocks = detail::calculate_blocks(new_size);
+    uint64_t block_shift = count / 64;
+    unsigned bit_shift = count % 64;
+
+    for (uint64_t idx = 0; idx < new_blocks; ++idx) {
+      uint64_t low = mData[idx + block_shift];
+      uint64_t high =
+          idx + block_shift + 1 < mBlocks ? mData[idx + block_shift + 1] : 0;
+      mData[idx] =
+          bit_shift ? (low >> bit_shift) | (high << (64 - bit_shift)) : low;
+    }
+    mBlocks = new_blocks;
+    mSize = new_size;
+    clear_tail();
     return *this;
   }
   // Binary operators
 private:
-  container &any_binary_operator(const container &other, auto binary_operator) {
+  // Runs a limb kernel over the blocks of other; blocks only this
+  // container has are kept, or cleared when clear_rest is set
+  container &any_binary_operator(const container &other,
+                                 kernels::binary_fn kernel, bool clear_rest) {
     expand(std::max(mSize, other.mSize), 0);
-    uint64_t left = 0, right = 0;
-    for (uint64_t block_idx = 0; block_idx < mBlocks; ++block_idx) {
-      left = block_idx < mBlocks ? mData[block_idx] : 0;
-      right = block_idx < other.mBlocks ? other.mData[block_idx] : 0;
-      mData[block_idx] = binary_operator(left, right);
-    }
+    kernel(mData, mData, other.mData, other.mBlocks);
+    if (clear_rest)
+      std::fill(mData + other.mBlocks, mData + mBlocks, 0);
     trim(*this);
     return *this;
   }
 
 public:
   container &operator|=(const container &other) {
-    return any_binary_operator(other, [](auto l, auto r) { return l | r; });
+    return any_binary_operator(other, kernels::active().or_n, false);
   }
   container &operator&=(const container &other) {
-    return any_binary_operator(other, [](auto l, auto r) { return l & r; });
+    return any_binary_operator(other, kernels::active().and_n, true);
   }
 
   container operator^(const container &other) const {
     container result(*this);
-    result.any_binary_operator(other, [](auto l, auto r) { return l ^ r; });
+    result.any_binary_operator(other, kernels::active().xor_n, false);
     return result;
   }
 
   container operator~() const {
     container result(*this);
-    for (uint64_t idx = 0; idx < result.mBlocks; ++idx)
-      result.mData[idx] = ~result.mData[idx];
+    kernels::active().com_n(result.mData, result.mData, result.mBlocks);
+    result.clear_tail();
     return result;
   }
 
@@ -506,38 +816,27 @@ public:
       throw std::invalid_argument("Base must be between 2 and 36");
     }
 
-    static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
-
-    bool is_zero = true;
-    for (uint64_t i = 0; i < mBlocks; ++i) {
-      if (mData[i] != 0) {
-        is_zero = false;
-        break;
-      }
-    }
-    if (is_zero) {
+    if (limbs::normalize(mData, mBlocks) == 0) {
       return "0";
     }
 
-    container num(*this);
-    std::stringstream ss;
-
-    while (num != container(1, 0)) {
-      uint64_t remainder = 0;
-      for (int64_t block_idx = num.mBlocks - 1; block_idx >= 0; --block_idx) {
-        __uint128_t temp =
-            (__uint128_t(remainder) << 64) | num.mData[block_idx];
-        num.mData[block_idx] = temp / base;
-        remainder = temp % base;
-      }
-
-      container::trim(num);
+    std::string result;
+    if (std::has_single_bit(base)) {
+      result = convert_to_power_of_two_base(base);
+    } else {
+      // powers[i] = chunk^(2^i), grown until the last one exceeds the value
+      const detail::radix_chunk_t chunk = detail::radix_chunk(base);
+      std::vector<container> powers{container(chunk.power)};
+      while (powers.back() <= *this)
+        powers.push_back(powers.back().square());
 
-      ss << digits[remainder];
+      result.assign(chunk.digits << (powers.size() - 1), '0');
+      container num(*this);
+      write_digits(num, powers, powers.size() - 1, chunk, base,
+                   result.data() + result.size());
     }
 
-    std::string result = ss.str();
-    std::reverse(result.begin(), result.end());
+    result.erase(0, std::min(result.find_first_not_of('0'), result.size() - 1));
     return result;
   }
 
@@ -23,12 +23,14 @@ class Blank {
 class User {
     cpp_int randomValue, voteInfo, hash, sign;
 public:
-    User() : randomValue(integers::getRandomInteger(512)) {}
+    User() : randomValue(integers::getSecureRandomBits(512)) {}
 
     template <typename T>
     void vote(const Blank<T>& blank) {
         voteInfo = (randomValue << 512) + blank.getHash();
-        hash = functions::fromHex(boost::compute::detail::sha1(voteInfo.str()));
+        // Hash the wire encoding; a decimal string costs far more to build
+        hash = functions::fromHex(
+            boost::compute::detail::sha1(wire::encode(voteInfo)));
     }
     const cpp_int& getVote() const { return voteInfo; }
     const cpp_int& getHash() const { return hash; }
@@ -45,6 +47,9 @@ class Server {
 private:
     RSA rsa;
     std::deque<votePair> votes;
+    // Blinding factors r and r^-1 mod N, inverted BLINDING_BATCH at a time
+    static constexpr size_t BLINDING_BATCH = 64;
+    std::vector<std::array<cpp_int, 2>> blinding;
 public:
     Server() {
         auto initPair = RSA::createPair(1024);
@@ -55,15 +60,15 @@ public:
             throw std::invalid_argument("This vote can't be signed");
         }
         cpp_int r, ir, h, h_, s, s_;
-        auto invPair = rsa.createInversePair(rsa.getN());
-        r = invPair[0], ir = invPair[1];
+        if (blinding.empty())
+            blinding = RSA::createInversePairs(rsa.getN(), BLINDING_BATCH);
+        r = blinding.back()[0], ir = blinding.back()[1];
+        blinding.pop_back();
         h = user.getHash();
-        h_ = functions::mulMod(h,
-            functions::powMod(r, rsa.getKey(0), rsa.getN()),
-            rsa.getN());
-        s_ = functions::powMod(h_, rsa.getKey(1), rsa.getN());
+        h_ = functions::mulMod(h, rsa.encrypt(r), rsa.getN());
+        s_ = rsa.sign(h_);
         s = functions::mulMod(s_, ir, rsa.getN());
-        if (h == functions::powMod(s, rsa.getKey(0), rsa.getN())) {
+        if (rsa.verify(h, s)) {
             votes.push_back({ user.getVote(), s });
             user.setSign(s);
         }
@@ -54,9 +54,23 @@ public:
 	}
 	
 	void useKey(const cpp_int& N, const cpp_int& p) {
+		useKey(N, functions::BarrettModulus(p));
+	}
+	void useKey(const cpp_int& N, const functions::BarrettModulus& p) {
 		literal = functions::powMod(literal, N, p);
 		number = functions::powMod(number, N, p);
 	}
+	// Wire format: literal, then number
+	void write(std::string& out) const {
+		wire::write(out, literal);
+		wire::write(out, number);
+	}
+	static Card read(std::string_view& in) {
+		Card card(D, TWO);
+		wire::read(in, card.literal);
+		wire::read(in, card.number);
+		return card;
+	}
 	friend bool operator==(const Card& lhs, const Card& rhs) {
 		return lhs.literal == rhs.literal && lhs.number == rhs.number;
 	}
@@ -86,7 +100,8 @@ public:
 	}
 
 	void useKey(const cpp_int& number, const cpp_int& p) {
-		for (auto& card : loadout) card.useKey(number, p);
+		const functions::BarrettModulus modulus(p);
+		for (auto& card : loadout) card.useKey(number, modulus);
 	}
 
 
@@ -98,13 +113,16 @@ private:
 	std::array<cpp_int, 2> keys;
 public:
 	Player(const cpp_int& p): loadout({}), keys(RSA::createInversePair(p - 1)){}
+	// Keys from RSA::createInversePairs(p - 1, players), made for a whole table at once
+	Player(const std::array<cpp_int, 2>& keys): loadout({}), keys(keys) {}
 	const std::deque<Card>& getLoadout() const { return loadout; }
 	void insertCard(const Card& card) {
 		loadout.emplace_back(card);
 	}
 	void useKey(const cpp_int& key, const cpp_int& p) {
+		const functions::BarrettModulus modulus(p);
 		for (auto& card : loadout) {
-			card.useKey(key, p);
+			card.useKey(key, modulus);
 		}
 	}
 	cpp_int getKey(size_t pos) const {
@@ -3,19 +3,48 @@
 #define _RSA_ALG_HPP
 
 #include "../RadInt.hpp"
+#include "../wire.hpp"
 
 class RSA {
 private:
   cpp_int _n = 0, _d = 0, _c = 0;
+  // The primes and CRT exponents of the private key: _c mod (P - 1),
+  // _c mod (Q - 1) and Q^-1 mod P
+  cpp_int _p = 0, _q = 0, _dP = 0, _dQ = 0, _qInv = 0;
+
+  void checkRange(const cpp_int &value) const {
+    if (value < 0 || value >= _n)
+      throw std::invalid_argument("Value must lie in [0, N)");
+  }
+
+  // value^_c mod N from two half-size exponentiations, recombined with
+  // Garner's formula
+  cpp_int privateOperation(const cpp_int &value) const {
+    if (_p == 0)
+      throw std::logic_error("RSA key holds no private part");
+    checkRange(value);
+    const cpp_int m1 = functions::powMod(value % _p, _dP, _p);
+    const cpp_int m2 = functions::powMod(value % _q, _dQ, _q);
+    const cpp_int h = functions::mulMod(_qInv, m1 - m2, _p);
+    return m2 + h * _q;
+  }
 
 public:
-  static std::array<cpp_int, 2> createPair(const size_t bit_count) {
-    cpp_int first, second;
-    first = primes::getRandomPrime(bit_count);
-    do {
-      second = primes::getRandomPrime(bit_count);
-    } while (first == second);
-    return std::array{first, second};
+  // Both primes are searched for at once on the generator's threads
+  static std::array<cpp_int, 2>
+  createPair(const size_t bit_count,
+             const primes::PrimeGenerator &generator = primes::PrimeGenerator(),
+             std::stop_token stop = {}) {
+    std::vector<cpp_int> found = generator.generate(bit_count, 2, stop);
+    return std::array{found[0], found[1]};
+  }
+  static std::future<std::array<cpp_int, 2>>
+  createPairAsync(const size_t bit_count,
+                  primes::PrimeGenerator generator = primes::PrimeGenerator(),
+                  std::stop_token stop = {}) {
+    return std::async(std::launch::async, [=] {
+      return createPair(bit_count, generator, stop);
+    });
   }
   static std::array<cpp_int, 2> createPair(const cpp_int &lower_bound,
                                            const cpp_int &upper_bound) {
@@ -27,25 +56,98 @@ public:
     return std::array{first, second};
   }
 
+  // A random unit modulo modulus and its inverse; one extended gcd per
+  // candidate both tests it and inverts it
   static std::array<cpp_int, 2> createInversePair(const cpp_int &modulus) {
-    cpp_int first, second;
-    do {
-      first = integers::getRandomInteger(1, modulus - 1);
-    } while (functions::gcd(first, modulus) != 1);
-    second = functions::invMod(first, modulus);
-    return std::array{first, second};
+    while (true) {
+      cpp_int first = integers::getRandomInteger(1, modulus - 1,
+                                                 rng::threadSecureEngine());
+      functions::cpp_int3D_t res = functions::Euclid_alg(first, modulus);
+      if (res.first != 1)
+        continue;
+      cpp_int second = res.second % modulus;
+      if (second < 0)
+        second += modulus;
+      return std::array{first, second};
+    }
+  }
+
+  // count such pairs, inverted together with one modular inversion
+  static std::vector<std::array<cpp_int, 2>>
+  createInversePairs(const cpp_int &modulus, const size_t count) {
+    std::vector<cpp_int> units;
+    units.reserve(count);
+    while (units.size() < count) {
+      cpp_int candidate = integers::getRandomInteger(
+          1, modulus - 1, rng::threadSecureEngine());
+      if (functions::gcd(candidate, modulus) == 1)
+        units.push_back(std::move(candidate));
+    }
+    std::vector<cpp_int> inverses = functions::batchInvMod(units, modulus);
+    std::vector<std::array<cpp_int, 2>> result;
+    result.reserve(count);
+    for (size_t idx = 0; idx < count; ++idx)
+      result.push_back({units[idx], inverses[idx]});
+    return result;
   }
 
   RSA() {}
-  RSA(const cpp_int &P, const cpp_int &Q) {
+  RSA(const cpp_int &P, const cpp_int &Q) : _p(P), _q(Q) {
     cpp_int fi = (P - 1) * (Q - 1);
     _n = P * Q;
     std::array<cpp_int, 2> inv_pair = createInversePair(fi);
     _d = inv_pair[0];
     _c = inv_pair[1];
+    _dP = _c % (P - 1);
+    _dQ = _c % (Q - 1);
+    _qInv = functions::invMod(Q % P, P);
   }
   cpp_int getKey(const uint8_t &n = 1) const { return (n == 0) ? _d : _c; }
   cpp_int getN() const { return _n; }
+
+  // Public key operations: message^_d mod N
+  cpp_int encrypt(const cpp_int &message) const {
+    checkRange(message);
+    return functions::powMod(message, _d, _n);
+  }
+  // An out-of-range signature is simply not valid
+  bool verify(const cpp_int &message, const cpp_int &signature) const {
+    if (signature < 0 || signature >= _n)
+      return false;
+    return encrypt(signature) == message;
+  }
+
+  // Private key operations, through the CRT: about four times cheaper
+  // than one exponentiation modulo N
+  cpp_int decrypt(const cpp_int &ciphertext) const {
+    return privateOperation(ciphertext);
+  }
+  cpp_int sign(const cpp_int &message) const {
+    return privateOperation(message);
+  }
+
+  // Wire format: N and the public exponent, then for the full key the
+  // private exponent and the CRT parameters
+  void writePublic(std::string &out) const {
+    wire::write(out, std::array{_n, _d});
+  }
+  void write(std::string &out) const {
+    wire::write(out, std::array{_n, _d, _c, _p, _q, _dP, _dQ, _qInv});
+  }
+  // A key holding only the public operations
+  static RSA readPublic(std::string_view &in) {
+    RSA key;
+    wire::read(in, key._n);
+    wire::read(in, key._d);
+    return key;
+  }
+  static RSA read(std::string_view &in) {
+    RSA key = readPublic(in);
+    for (cpp_int *part : {&key._c, &key._p, &key._q, &key._dP, &key._dQ,
+                          &key._qInv})
+      wire::read(in, *part);
+    return key;
+  }
 };
 
 #endif
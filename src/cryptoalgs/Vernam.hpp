@@ -6,7 +6,7 @@
 
 cpp_int Vernam_key(const cpp_int &Number) {
   size_t len = functions::bitCount(Number) + 1;
-  return integers::getRandomBits(len);
+  return integers::getSecureRandomBits(len);
 }
 cpp_int Vernam_alg(const cpp_int &message, const cpp_int &key) {
   return message ^ key;
@@ -0,0 +1,393 @@
+#pragma once
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BITS_X86_KERNELS 1
+#include <cpuid.h>
+#include <immintrin.h>
+#else
+#define BITS_X86_KERNELS 0
+#endif
+
+// Innermost limb loops behind a table of function pointers. The table is
+// chosen once, on first use, from what the CPU reports; the portable
+// versions are always available as the fallback.
+namespace bits::kernels {
+
+// r = a op b over n limbs, returning the carry or borrow
+using carry_fn = uint64_t (*)(uint64_t *, const uint64_t *, const uint64_t *,
+                              uint64_t);
+// r = a * b (or r += a * b) over n limbs, returning the high limb
+using mul_fn = uint64_t (*)(uint64_t *, const uint64_t *, uint64_t, uint64_t);
+using binary_fn = void (*)(uint64_t *, const uint64_t *, const uint64_t *,
+                           uint64_t);
+using unary_fn = void (*)(uint64_t *, const uint64_t *, uint64_t);
+// Three-way compare of two n-limb numbers
+using cmp_fn = int (*)(const uint64_t *, const uint64_t *, uint64_t);
+
+struct table {
+  const char *name;
+  carry_fn add_n;
+  carry_fn sub_n;
+  mul_fn mul_1;
+  mul_fn addmul_1;
+  binary_fn and_n;
+  binary_fn or_n;
+  binary_fn xor_n;
+  unary_fn com_n;
+  cmp_fn cmp_n;
+};
+
+namespace portable {
+
+inline uint64_t add_n(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                      uint64_t n) {
+  uint64_t carry = 0;
+  for (uint64_t idx = 0; idx < n; ++idx) {
+    __uint128_t sum = static_cast<__uint128_t>(a[idx]) + b[idx] + carry;
+    r[idx] = static_cast<uint64_t>(sum);
+    carry = static_cast<uint64_t>(sum >> 64);
+  }
+  return carry;
+}
+
+inline uint64_t sub_n(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                      uint64_t n) {
+  uint64_t borrow = 0;
+  for (uint64_t idx = 0; idx < n; ++idx) {
+    uint64_t left = a[idx], right = b[idx];
+    uint64_t diff = left - right;
+    uint64_t next_borrow = (left < right) | (diff < borrow);
+    r[idx] = diff - borrow;
+    borrow = next_borrow;
+  }
+  return borrow;
+}
+
+inline uint64_t mul_1(uint64_t *r, const uint64_t *a, uint64_t n,
+                      uint64_t b) {
+  uint64_t carry = 0;
+  for (uint64_t idx = 0; idx < n; ++idx) {
+    __uint128_t product = static_cast<__uint128_t>(a[idx]) * b + carry;
+    r[idx] = static_cast<uint64_t>(product);
+    carry = static_cast<uint64_t>(product >> 64);
+  }
+  return carry;
+}
+
+inline uint64_t addmul_1(uint64_t *r, const uint64_t *a, uint64_t n,
+                         uint64_t b) {
+  uint64_t carry = 0;
+  for (uint64_t idx = 0; idx < n; ++idx) {
+    __uint128_t product =
+        static_cast<__uint128_t>(a[idx]) * b + r[idx] + carry;
+    r[idx] = static_cast<uint64_t>(product);
+    carry = static_cast<uint64_t>(product >> 64);
+  }
+  return carry;
+}
+
+inline void and_n(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                  uint64_t n) {
+  for (uint64_t idx = 0; idx < n; ++idx)
+    r[idx] = a[idx] & b[idx];
+}
+
+inline void or_n(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                 uint64_t n) {
+  for (uint64_t idx = 0; idx < n; ++idx)
+    r[idx] = a[idx] | b[idx];
+}
+
+inline void xor_n(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                  uint64_t n) {
+  for (uint64_t idx = 0; idx < n; ++idx)
+    r[idx] = a[idx] ^ b[idx];
+}
+
+inline void com_n(uint64_t *r, const uint64_t *a, uint64_t n) {
+  for (uint64_t idx = 0; idx < n; ++idx)
+    r[idx] = ~a[idx];
+}
+
+inline int cmp_n(const uint64_t *a, const uint64_t *b, uint64_t n) {
+  for (uint64_t idx = n; idx-- > 0;)
+    if (a[idx] != b[idx])
+      return a[idx] < b[idx] ? -1 : 1;
+  return 0;
+}
+
+constexpr table TABLE = {"portable", add_n, sub_n, mul_1, addmul_1,
+                         and_n,      or_n,  xor_n, com_n, cmp_n};
+
+} // namespace portable
+
+#if BITS_X86_KERNELS
+
+// Carry chains on ADX/BMI2: MULX leaves the flags alone, so the product
+// chain (ADCX, carry flag) and the accumulation chain (ADOX, overflow
+// flag) run interleaved without saving flags
+namespace adx {
+
+__attribute__((target("adx"))) inline uint64_t
+add_n(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n) {
+  unsigned char carry = 0;
+  uint64_t idx = 0;
+  unsigned long long sum;
+  for (; idx + 4 <= n; idx += 4) {
+    carry = _addcarryx_u64(carry, a[idx], b[idx], &sum);
+    r[idx] = sum;
+    carry = _addcarryx_u64(carry, a[idx + 1], b[idx + 1], &sum);
+    r[idx + 1] = sum;
+    carry = _addcarryx_u64(carry, a[idx + 2], b[idx + 2], &sum);
+    r[idx + 2] = sum;
+    carry = _addcarryx_u64(carry, a[idx + 3], b[idx + 3], &sum);
+    r[idx + 3] = sum;
+  }
+  for (; idx < n; ++idx) {
+    carry = _addcarryx_u64(carry, a[idx], b[idx], &sum);
+    r[idx] = sum;
+  }
+  return carry;
+}
+
+__attribute__((target("adx"))) inline uint64_t
+sub_n(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n) {
+  unsigned char borrow = 0;
+  uint64_t idx = 0;
+  unsigned long long diff;
+  for (; idx + 4 <= n; idx += 4) {
+    borrow = _subborrow_u64(borrow, a[idx], b[idx], &diff);
+    r[idx] = diff;
+    borrow = _subborrow_u64(borrow, a[idx + 1], b[idx + 1], &diff);
+    r[idx + 1] = diff;
+    borrow = _subborrow_u64(borrow, a[idx + 2], b[idx + 2], &diff);
+    r[idx + 2] = diff;
+    borrow = _subborrow_u64(borrow, a[idx + 3], b[idx + 3], &diff);
+    r[idx + 3] = diff;
+  }
+  for (; idx < n; ++idx) {
+    borrow = _subborrow_u64(borrow, a[idx], b[idx], &diff);
+    r[idx] = diff;
+  }
+  return borrow;
+}
+
+__attribute__((target("bmi2,adx"))) inline uint64_t
+mul_1(uint64_t *r, const uint64_t *a, uint64_t n, uint64_t b) {
+  unsigned char carry = 0;
+  unsigned long long high_prev = 0, high, low;
+  for (uint64_t idx = 0; idx < n; ++idx) {
+    low = _mulx_u64(a[idx], b, &high);
+    carry = _addcarryx_u64(carry, low, high_prev, &low);
+    r[idx] = low;
+    high_prev = high;
+  }
+  return high_prev + carry;
+}
+
+__attribute__((target("bmi2,adx"))) inline uint64_t
+addmul_1(uint64_t *r, const uint64_t *a, uint64_t n, uint64_t b) {
+  if (n == 0)
+    return 0;
+  uint64_t high_prev = 0, low, high;
+  // rcx counts up from -n to zero; LEA and JRCXZ keep both flags intact
+  int64_t idx = -static_cast<int64_t>(n);
+  const uint64_t *a_end = a + n;
+  uint64_t *r_end = r + n;
+  __asm__ volatile("xorl %%eax, %%eax\n\t" // clears CF and OF
+                   "1:\n\t"
+                   "mulxq (%[a],%[idx],8), %[low], %[high]\n\t"
+                   "adcxq %[high_prev], %[low]\n\t"
+                   "adoxq (%[r],%[idx],8), %[low]\n\t"
+                   "movq %[low], (%[r],%[idx],8)\n\t"
+                   "movq %[high], %[high_prev]\n\t"
+                   "leaq 1(%[idx]), %[idx]\n\t"
+                   "jrcxz 2f\n\t"
+                   "jmp 1b\n\t"
+                   "2:\n\t"
+                   "movl $0, %%eax\n\t"
+                   "adcxq %%rax, %[high_prev]\n\t"
+                   "adoxq %%rax, %[high_prev]\n\t"
+                   : [high_prev] "+&r"(high_prev), [low] "=&r"(low),
+                     [high] "=&r"(high), [idx] "+&c"(idx)
+                   : [a] "r"(a_end), [r] "r"(r_end), "d"(b)
+                   : "rax", "cc", "memory");
+  return high_prev;
+}
+
+} // namespace adx
+
+namespace avx2 {
+
+__attribute__((target("avx2"))) inline __m256i load(const uint64_t *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+__attribute__((target("avx2"))) inline void store(uint64_t *p, __m256i v) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+}
+
+__attribute__((target("avx2"))) inline void
+and_n(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n) {
+  uint64_t idx = 0;
+  for (; idx + 4 <= n; idx += 4)
+    store(r + idx, _mm256_and_si256(load(a + idx), load(b + idx)));
+  portable::and_n(r + idx, a + idx, b + idx, n - idx);
+}
+
+__attribute__((target("avx2"))) inline void
+or_n(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n) {
+  uint64_t idx = 0;
+  for (; idx + 4 <= n; idx += 4)
+    store(r + idx, _mm256_or_si256(load(a + idx), load(b + idx)));
+  portable::or_n(r + idx, a + idx, b + idx, n - idx);
+}
+
+__attribute__((target("avx2"))) inline void
+xor_n(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n) {
+  uint64_t idx = 0;
+  for (; idx + 4 <= n; idx += 4)
+    store(r + idx, _mm256_xor_si256(load(a + idx), load(b + idx)));
+  portable::xor_n(r + idx, a + idx, b + idx, n - idx);
+}
+
+__attribute__((target("avx2"))) inline void com_n(uint64_t *r,
+                                                  const uint64_t *a,
+                                                  uint64_t n) {
+  const __m256i ones = _mm256_set1_epi64x(-1);
+  uint64_t idx = 0;
+  for (; idx + 4 <= n; idx += 4)
+    store(r + idx, _mm256_xor_si256(load(a + idx), ones));
+  portable::com_n(r + idx, a + idx, n - idx);
+}
+
+// Skips equal 4-limb groups from the top, then decides on the first
+// differing limb
+__attribute__((target("avx2"))) inline int cmp_n(const uint64_t *a,
+                                                 const uint64_t *b,
+                                                 uint64_t n) {
+  uint64_t idx = n;
+  while (idx >= 4) {
+    __m256i equal_lanes =
+        _mm256_cmpeq_epi64(load(a + idx - 4), load(b + idx - 4));
+    unsigned equal = _mm256_movemask_pd(_mm256_castsi256_pd(equal_lanes));
+    if (equal != 0xF) {
+      uint64_t lane = idx - 4 + (31 - __builtin_clz(~equal & 0xF));
+      return a[lane] < b[lane] ? -1 : 1;
+    }
+    idx -= 4;
+  }
+  return portable::cmp_n(a, b, idx);
+}
+
+} // namespace avx2
+
+namespace avx512 {
+
+__attribute__((target("avx512f"))) inline void
+and_n(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n) {
+  uint64_t idx = 0;
+  for (; idx + 8 <= n; idx += 8)
+    _mm512_storeu_si512(r + idx, _mm512_and_si512(_mm512_loadu_si512(a + idx),
+                                                  _mm512_loadu_si512(b + idx)));
+  avx2::and_n(r + idx, a + idx, b + idx, n - idx);
+}
+
+__attribute__((target("avx512f"))) inline void
+or_n(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n) {
+  uint64_t idx = 0;
+  for (; idx + 8 <= n; idx += 8)
+    _mm512_storeu_si512(r + idx, _mm512_or_si512(_mm512_loadu_si512(a + idx),
+                                                 _mm512_loadu_si512(b + idx)));
+  avx2::or_n(r + idx, a + idx, b + idx, n - idx);
+}
+
+__attribute__((target("avx512f"))) inline void
+xor_n(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n) {
+  uint64_t idx = 0;
+  for (; idx + 8 <= n; idx += 8)
+    _mm512_storeu_si512(r + idx, _mm512_xor_si512(_mm512_loadu_si512(a + idx),
+                                                  _mm512_loadu_si512(b + idx)));
+  avx2::xor_n(r + idx, a + idx, b + idx, n - idx);
+}
+
+__attribute__((target("avx512f"))) inline void com_n(uint64_t *r,
+                                                    const uint64_t *a,
+                                                    uint64_t n) {
+  const __m512i ones = _mm512_set1_epi64(-1);
+  uint64_t idx = 0;
+  for (; idx + 8 <= n; idx += 8)
+    _mm512_storeu_si512(r + idx,
+                        _mm512_xor_si512(_mm512_loadu_si512(a + idx), ones));
+  avx2::com_n(r + idx, a + idx, n - idx);
+}
+
+__attribute__((target("avx512f"))) inline int cmp_n(const uint64_t *a,
+                                                   const uint64_t *b,
+                                                   uint64_t n) {
+  uint64_t idx = n;
+  while (idx >= 8) {
+    __mmask8 equal = _mm512_cmpeq_epu64_mask(_mm512_loadu_si512(a + idx - 8),
+                                             _mm512_loadu_si512(b + idx - 8));
+    if (equal != 0xFF) {
+      uint64_t lane = idx - 8 + (31 - __builtin_clz(~equal & 0xFFu));
+      return a[lane] < b[lane] ? -1 : 1;
+    }
+    idx -= 8;
+  }
+  return avx2::cmp_n(a, b, idx);
+}
+
+} // namespace avx512
+
+inline bool cpu_has_adx() {
+  unsigned eax, ebx, ecx, edx;
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    return false;
+  return (ebx & bit_ADX) != 0;
+}
+
+#endif // BITS_X86_KERNELS
+
+// Picks the best table for this CPU
+inline table select() {
+  table result = portable::TABLE;
+#if BITS_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("bmi2") && cpu_has_adx()) {
+    result.name = "adx";
+    result.add_n = adx::add_n;
+    result.sub_n = adx::sub_n;
+    result.mul_1 = adx::mul_1;
+    result.addmul_1 = adx::addmul_1;
+  }
+  if (__builtin_cpu_supports("avx512f")) {
+    result.and_n = avx512::and_n;
+    result.or_n = avx512::or_n;
+    result.xor_n = avx512::xor_n;
+    result.com_n = avx512::com_n;
+    result.cmp_n = avx512::cmp_n;
+  } else if (__builtin_cpu_supports("avx2")) {
+    result.and_n = avx2::and_n;
+    result.or_n = avx2::or_n;
+    result.xor_n = avx2::xor_n;
+    result.com_n = avx2::com_n;
+    result.cmp_n = avx2::cmp_n;
+  }
+#endif
+  return result;
+}
+
+// The table in use, selected on first call
+inline const table &active() {
+  static const table selected = select();
+  return selected;
+}
+
+} // namespace bits::kernels
+
+#endif // !KERNELS_HPP
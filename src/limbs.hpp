@@ -0,0 +1,633 @@
+#pragma once
+#ifndef LIMBS_HPP
+#define LIMBS_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "kernels.hpp"
+#include "ntt.hpp"
+#include "word.hpp"
+
+// Low level arithmetic on little-endian arrays of 64-bit limbs.
+// Nothing here allocates the destination: callers pass buffers of the
+// documented size. Unless stated otherwise destinations must not overlap
+// the sources.
+namespace bits::limbs {
+
+// Operand sizes (in limbs) where the next multiplication algorithm wins
+constexpr uint64_t KARATSUBA_THRESHOLD = 40;
+constexpr uint64_t TOOM3_THRESHOLD = 192;
+constexpr uint64_t KARATSUBA_SQR_THRESHOLD = 56;
+constexpr uint64_t TOOM3_SQR_THRESHOLD = 256;
+constexpr uint64_t NTT_THRESHOLD = 3000;
+constexpr uint64_t NTT_SQR_THRESHOLD = 3000;
+// Divisor (and quotient) size in limbs where Burnikel-Ziegler beats Knuth D,
+// and the block size its recursion bottoms out at
+constexpr uint64_t BURNIKEL_ZIEGLER_THRESHOLD = 200;
+constexpr uint64_t BURNIKEL_ZIEGLER_BASECASE = 40;
+
+inline uint64_t normalize(const uint64_t *a, uint64_t n) {
+  while (n > 0 && a[n - 1] == 0)
+    --n;
+  return n;
+}
+
+inline int cmp(const uint64_t *a, const uint64_t *b, uint64_t n) {
+  return kernels::active().cmp_n(a, b, n);
+}
+
+// r = a + b, returns carry. r may alias a or b.
+inline uint64_t add_n(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                      uint64_t n) {
+  return kernels::active().add_n(r, a, b, n);
+}
+
+// r = a + b, returns carry. r may alias a or b.
+inline uint64_t add_1(uint64_t *r, const uint64_t *a, uint64_t n,
+                      uint64_t b) {
+  uint64_t idx = 0;
+  for (; idx < n && b; ++idx) {
+    r[idx] = a[idx] + b;
+    b = r[idx] < b;
+  }
+  if (r != a)
+    std::copy(a + idx, a + n, r + idx);
+  return b;
+}
+
+// r = a + b where an >= bn, returns carry. r may alias a.
+inline uint64_t add(uint64_t *r, const uint64_t *a, uint64_t an,
+                    const uint64_t *b, uint64_t bn) {
+  uint64_t carry = add_n(r, a, b, bn);
+  return add_1(r + bn, a + bn, an - bn, carry);
+}
+
+// r = a - b, returns borrow. r may alias a or b.
+inline uint64_t sub_n(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                      uint64_t n) {
+  return kernels::active().sub_n(r, a, b, n);
+}
+
+// r = a - b, returns borrow. r may alias a.
+inline uint64_t sub_1(uint64_t *r, const uint64_t *a, uint64_t n,
+                      uint64_t b) {
+  uint64_t idx = 0;
+  for (; idx < n && b; ++idx) {
+    uint64_t left = a[idx];
+    r[idx] = left - b;
+    b = left < b;
+  }
+  if (r != a)
+    std::copy(a + idx, a + n, r + idx);
+  return b;
+}
+
+// r = a - b where an >= bn, returns borrow. r may alias a.
+inline uint64_t sub(uint64_t *r, const uint64_t *a, uint64_t an,
+                    const uint64_t *b, uint64_t bn) {
+  uint64_t borrow = sub_n(r, a, b, bn);
+  return sub_1(r + bn, a + bn, an - bn, borrow);
+}
+
+// r = a * b, returns the high limb. r may alias a.
+inline uint64_t mul_1(uint64_t *r, const uint64_t *a, uint64_t n,
+                      uint64_t b) {
+  return kernels::active().mul_1(r, a, n, b);
+}
+
+// r += a * b, returns the carry limb
+inline uint64_t addmul_1(uint64_t *r, const uint64_t *a, uint64_t n,
+                         uint64_t b) {
+  return kernels::active().addmul_1(r, a, n, b);
+}
+
+// r -= a * b, returns the borrow limb
+inline uint64_t submul_1(uint64_t *r, const uint64_t *a, uint64_t n,
+                         uint64_t b) {
+  uint64_t borrow = 0;
+  for (uint64_t idx = 0; idx < n; ++idx) {
+    __uint128_t product = static_cast<__uint128_t>(a[idx]) * b + borrow;
+    uint64_t low = static_cast<uint64_t>(product);
+    borrow = static_cast<uint64_t>(product >> 64);
+    uint64_t left = r[idx];
+    r[idx] = left - low;
+    borrow += left < low;
+  }
+  return borrow;
+}
+
+// r = a << shift for 0 < shift < 64, returns the bits shifted out.
+// r may alias a.
+inline uint64_t lshift(uint64_t *r, const uint64_t *a, uint64_t n,
+                       unsigned shift) {
+  uint64_t out = 0;
+  for (uint64_t idx = n; idx-- > 0;) {
+    uint64_t current = a[idx];
+    if (idx + 1 == n)
+      out = current >> (64 - shift);
+    else
+      r[idx + 1] |= current >> (64 - shift);
+    r[idx] = current << shift;
+  }
+  return out;
+}
+
+// r = a >> shift for 0 < shift < 64, returns the bits shifted out (in the
+// top of the limb). r may alias a.
+inline uint64_t rshift(uint64_t *r, const uint64_t *a, uint64_t n,
+                       unsigned shift) {
+  if (n == 0)
+    return 0;
+  uint64_t out = a[0] << (64 - shift);
+  for (uint64_t idx = 0; idx + 1 < n; ++idx)
+    r[idx] = (a[idx] >> shift) | (a[idx + 1] << (64 - shift));
+  r[n - 1] = a[n - 1] >> shift;
+  return out;
+}
+
+// a /= 3 in place, a must be divisible by 3
+inline void divexact_by3(uint64_t *a, uint64_t n) {
+  constexpr uint64_t INVERSE_3 = 0xAAAAAAAAAAAAAAABull;
+  uint64_t borrow = 0;
+  for (uint64_t idx = 0; idx < n; ++idx) {
+    uint64_t current = a[idx];
+    uint64_t next_borrow = current < borrow;
+    uint64_t quotient = (current - borrow) * INVERSE_3;
+    a[idx] = quotient;
+    borrow = next_borrow +
+             static_cast<uint64_t>((static_cast<__uint128_t>(quotient) * 3) >>
+                                   64);
+  }
+}
+
+// r[0, an + bn) = a * b, an >= bn >= 1
+inline void mul_basecase(uint64_t *r, const uint64_t *a, uint64_t an,
+                         const uint64_t *b, uint64_t bn) {
+  r[an] = mul_1(r, a, an, b[0]);
+  for (uint64_t idx = 1; idx < bn; ++idx)
+    r[an + idx] = addmul_1(r + idx, a, an, b[idx]);
+}
+
+// r[0, 2n) = a * a, n >= 1
+inline void sqr_basecase(uint64_t *r, const uint64_t *a, uint64_t n) {
+  // Cross products a[i] * a[j] for i < j, each computed once
+  r[0] = 0;
+  r[2 * n - 1] = 0;
+  if (n > 1) {
+    r[n] = mul_1(r + 1, a + 1, n - 1, a[0]);
+    for (uint64_t idx = 1; idx + 1 < n; ++idx)
+      r[idx + n] = addmul_1(r + 2 * idx + 1, a + idx + 1, n - idx - 1, a[idx]);
+    lshift(r, r, 2 * n, 1);
+  }
+  // Diagonal squares
+  uint64_t carry = 0;
+  for (uint64_t idx = 0; idx < n; ++idx) {
+    __uint128_t square = static_cast<__uint128_t>(a[idx]) * a[idx];
+    __uint128_t low = static_cast<__uint128_t>(r[2 * idx]) +
+                      static_cast<uint64_t>(square) + carry;
+    r[2 * idx] = static_cast<uint64_t>(low);
+    __uint128_t high = static_cast<__uint128_t>(r[2 * idx + 1]) +
+                       static_cast<uint64_t>(square >> 64) +
+                       static_cast<uint64_t>(low >> 64);
+    r[2 * idx + 1] = static_cast<uint64_t>(high);
+    carry = static_cast<uint64_t>(high >> 64);
+  }
+}
+
+inline void mul(uint64_t *r, const uint64_t *a, uint64_t an, const uint64_t *b,
+                uint64_t bn);
+inline void sqr(uint64_t *r, const uint64_t *a, uint64_t n);
+
+namespace detail {
+
+// r[0, rn) += c << (64 * offset), the sum must fit in rn limbs
+inline void add_at(uint64_t *r, uint64_t rn, uint64_t offset,
+                   const uint64_t *c, uint64_t cn) {
+  cn = normalize(c, cn);
+  if (cn)
+    add(r + offset, r + offset, rn - offset, c, cn);
+}
+
+// Product of two operands that may carry zero top limbs
+template <bool Square>
+void product(uint64_t *r, const uint64_t *a, uint64_t an, const uint64_t *b,
+             uint64_t bn) {
+  if constexpr (Square)
+    sqr(r, a, an);
+  else
+    mul(r, a, an, b, bn);
+}
+
+// Karatsuba for an >= bn >= ceil(an / 2)
+template <bool Square>
+void karatsuba(uint64_t *r, const uint64_t *a, uint64_t an, const uint64_t *b,
+               uint64_t bn) {
+  const uint64_t k = (an + 1) / 2;
+  const uint64_t a1n = an - k, b1n = bn - k, rn = an + bn;
+
+  // z0 = a0 * b0 and z2 = a1 * b1 go straight into place
+  product<Square>(r, a, k, b, k);
+  if (b1n)
+    product<Square>(r + 2 * k, a + k, a1n, b + k, b1n);
+  else
+    std::fill(r + 2 * k, r + rn, 0);
+
+  // z1 = (a0 + a1) * (b0 + b1) - z0 - z2
+  std::vector<uint64_t> scratch(4 * k + 4);
+  uint64_t *sa = scratch.data(), *sb = sa + k + 1, *z1 = sb + k + 1;
+  sa[k] = add(sa, a, k, a + k, a1n);
+  if constexpr (Square) {
+    sqr(z1, sa, k + 1);
+  } else {
+    sb[k] = add(sb, b, k, b + k, b1n);
+    mul(z1, sa, k + 1, sb, k + 1);
+  }
+  sub(z1, z1, 2 * k + 2, r, 2 * k);
+  sub(z1, z1, 2 * k + 2, r + 2 * k, rn - 2 * k);
+  add_at(r, rn, k, z1, 2 * k + 2);
+}
+
+// Evaluates a0 + a1 x + a2 x^2 at 1, -1 and 2 into m = k + 1 limbs each.
+// Returns true when the value at -1 is negative (p_m1 holds the magnitude).
+inline bool toom3_evaluate(const uint64_t *a, uint64_t k, uint64_t a2n,
+                           uint64_t *p1, uint64_t *p_m1, uint64_t *p2) {
+  const uint64_t m = k + 1;
+  const uint64_t *a0 = a, *a1 = a + k, *a2 = a + 2 * k;
+
+  // p1 = a0 + a2, then p_m1 = |p1 - a1| and p1 += a1
+  p1[k] = add(p1, a0, k, a2, a2n);
+  bool negative = !p1[k] && cmp(p1, a1, k) < 0;
+  if (negative) {
+    sub_n(p_m1, a1, p1, k);
+    p_m1[k] = 0;
+  } else {
+    p_m1[k] = p1[k] - sub_n(p_m1, p1, a1, k);
+  }
+  p1[k] += add_n(p1, p1, a1, k);
+
+  // p2 = ((2 * a2 + a1) * 2) + a0
+  std::fill(p2, p2 + m, 0);
+  std::copy(a2, a2 + a2n, p2);
+  lshift(p2, p2, m, 1);
+  add(p2, p2, m, a1, k);
+  lshift(p2, p2, m, 1);
+  add(p2, p2, m, a0, k);
+  return negative;
+}
+
+// Toom-Cook 3-way for an >= bn > 2 * ceil(an / 3), evaluating at
+// 0, 1, -1, 2 and infinity
+template <bool Square>
+void toom3(uint64_t *r, const uint64_t *a, uint64_t an, const uint64_t *b,
+           uint64_t bn) {
+  const uint64_t k = (an + 2) / 3, m = k + 1, l = 2 * m;
+  const uint64_t a2n = an - 2 * k, b2n = bn - 2 * k, rn = an + bn;
+
+  std::vector<uint64_t> scratch(6 * m + 3 * l);
+  uint64_t *pa1 = scratch.data(), *pa_m1 = pa1 + m, *pa2 = pa_m1 + m;
+  uint64_t *pb1 = pa2 + m, *pb_m1 = pb1 + m, *pb2 = pb_m1 + m;
+  uint64_t *v1 = pb2 + m, *v_m1 = v1 + l, *v2 = v_m1 + l;
+
+  bool negative = toom3_evaluate(a, k, a2n, pa1, pa_m1, pa2);
+  if constexpr (Square) {
+    negative = false;
+    sqr(v1, pa1, m);
+    sqr(v_m1, pa_m1, m);
+    sqr(v2, pa2, m);
+  } else {
+    negative ^= toom3_evaluate(b, k, b2n, pb1, pb_m1, pb2);
+    mul(v1, pa1, m, pb1, m);
+    mul(v_m1, pa_m1, m, pb_m1, m);
+    mul(v2, pa2, m, pb2, m);
+  }
+
+  // c0 and c4 go straight into place
+  const uint64_t c4n = a2n + b2n;
+  product<Square>(r, a, k, b, k);
+  std::fill(r + 2 * k, r + 4 * k, 0);
+  product<Square>(r + 4 * k, a + 2 * k, a2n, b + 2 * k, b2n);
+  const uint64_t *c0 = r, *c4 = r + 4 * k;
+
+  // v(-1) <- (v1 - v(-1)) / 2 = c1 + c3, v1 <- v1 - v(-1) = c0 + c2 + c4
+  if (negative)
+    add_n(v_m1, v1, v_m1, l);
+  else
+    sub_n(v_m1, v1, v_m1, l);
+  rshift(v_m1, v_m1, l, 1);
+  sub_n(v1, v1, v_m1, l);
+  uint64_t *c2 = v1, *c13 = v_m1;
+  sub(c2, c2, l, c0, 2 * k);
+  sub(c2, c2, l, c4, c4n);
+
+  // v2 <- (v2 - c0 - 4 c2 - 16 c4) / 2 - (c1 + c3) = 3 c3
+  std::vector<uint64_t> shifted(l);
+  sub(v2, v2, l, c0, 2 * k);
+  lshift(shifted.data(), c2, l, 2);
+  sub_n(v2, v2, shifted.data(), l);
+  std::fill(shifted.begin(), shifted.end(), 0);
+  std::copy(c4, c4 + c4n, shifted.data());
+  lshift(shifted.data(), shifted.data(), l, 4);
+  sub_n(v2, v2, shifted.data(), l);
+  rshift(v2, v2, l, 1);
+  sub_n(v2, v2, c13, l);
+  divexact_by3(v2, l);
+  uint64_t *c3 = v2, *c1 = c13;
+  sub_n(c1, c1, c3, l);
+
+  add_at(r, rn, k, c1, l);
+  add_at(r, rn, 2 * k, c2, l);
+  add_at(r, rn, 3 * k, c3, l);
+}
+
+} // namespace detail
+
+// r[0, an + bn) = a * b. Operands may carry zero top limbs.
+inline void mul(uint64_t *r, const uint64_t *a, uint64_t an, const uint64_t *b,
+                uint64_t bn) {
+  if (an < bn) {
+    std::swap(a, b);
+    std::swap(an, bn);
+  }
+  const uint64_t rn = an + bn;
+  const uint64_t real_an = normalize(a, an), real_bn = normalize(b, bn);
+  if (real_an == 0 || real_bn == 0) {
+    std::fill(r, r + rn, 0);
+    return;
+  }
+  if (real_an != an || real_bn != bn) {
+    std::fill(r + real_an + real_bn, r + rn, 0);
+    mul(r, a, real_an, b, real_bn);
+    return;
+  }
+  if (an == bn && (a == b || std::equal(a, a + an, b))) {
+    sqr(r, a, an);
+    return;
+  }
+
+  if (bn < KARATSUBA_THRESHOLD) {
+    mul_basecase(r, a, an, b, bn);
+  } else if (bn >= NTT_THRESHOLD) {
+    ntt::mul(r, a, an, b, bn);
+  } else if (2 * bn <= an) {
+    // Unbalanced operands: multiply b by bn-sized slices of a
+    std::vector<uint64_t> slice(2 * bn);
+    mul(r, a, bn, b, bn);
+    std::fill(r + 2 * bn, r + rn, 0);
+    for (uint64_t offset = bn; offset < an; offset += bn) {
+      uint64_t len = std::min(bn, an - offset);
+      mul(slice.data(), a + offset, len, b, bn);
+      detail::add_at(r, rn, offset, slice.data(), len + bn);
+    }
+  } else if (bn >= TOOM3_THRESHOLD && bn > 2 * ((an + 2) / 3)) {
+    detail::toom3<false>(r, a, an, b, bn);
+  } else {
+    detail::karatsuba<false>(r, a, an, b, bn);
+  }
+}
+
+// r[0, 2n) = a * a. The operand may carry zero top limbs.
+inline void sqr(uint64_t *r, const uint64_t *a, uint64_t n) {
+  const uint64_t real_n = normalize(a, n);
+  std::fill(r + 2 * real_n, r + 2 * n, 0);
+  if (real_n == 0)
+    return;
+  if (real_n < KARATSUBA_SQR_THRESHOLD)
+    sqr_basecase(r, a, real_n);
+  else if (real_n < TOOM3_SQR_THRESHOLD)
+    detail::karatsuba<true>(r, a, real_n, a, real_n);
+  else if (real_n >= NTT_SQR_THRESHOLD)
+    ntt::sqr(r, a, real_n);
+  else
+    detail::toom3<true>(r, a, real_n, a, real_n);
+}
+
+// Floor((B^2 - 1) / d) - B for a normalized d (top bit set)
+inline uint64_t reciprocal(uint64_t d) {
+  return static_cast<uint64_t>(
+      ((static_cast<__uint128_t>(~d) << 64) | ~0ull) / d);
+}
+
+// Divides <u1, u0> by a normalized d with u1 < d using the precomputed
+// reciprocal v (Moller-Granlund), returns the quotient and stores the
+// remainder in r
+inline uint64_t div_2by1(uint64_t &r, uint64_t u1, uint64_t u0, uint64_t d,
+                         uint64_t v) {
+  __uint128_t estimate = static_cast<__uint128_t>(v) * u1 +
+                         ((static_cast<__uint128_t>(u1) << 64) | u0);
+  uint64_t q1 = static_cast<uint64_t>(estimate >> 64) + 1;
+  uint64_t q0 = static_cast<uint64_t>(estimate);
+  uint64_t rem = u0 - q1 * d;
+  if (rem > q0) {
+    --q1;
+    rem += d;
+  }
+  if (rem >= d) {
+    ++q1;
+    rem -= d;
+  }
+  r = rem;
+  return q1;
+}
+
+// q[0, n) = a / d, returns a % d. q may alias a.
+inline uint64_t divmod_1(uint64_t *q, const uint64_t *a, uint64_t n,
+                         uint64_t d) {
+  if (n == 0)
+    return 0;
+  const unsigned shift = std::countl_zero(d);
+  const uint64_t norm = d << shift, v = reciprocal(norm);
+  uint64_t rem = shift ? a[n - 1] >> (64 - shift) : 0;
+  for (uint64_t idx = n; idx-- > 0;) {
+    uint64_t low = a[idx] << shift;
+    if (shift && idx > 0)
+      low |= a[idx - 1] >> (64 - shift);
+    q[idx] = div_2by1(rem, rem, low, norm, v);
+  }
+  return rem >> shift;
+}
+
+// a % d without producing the quotient
+inline uint64_t mod_1(const uint64_t *a, uint64_t n, uint64_t d) {
+  const unsigned shift = std::countl_zero(d);
+  const uint64_t norm = d << shift, v = reciprocal(norm);
+  uint64_t rem = shift && n ? a[n - 1] >> (64 - shift) : 0;
+  for (uint64_t idx = n; idx-- > 0;) {
+    uint64_t low = a[idx] << shift;
+    if (shift && idx > 0)
+      low |= a[idx - 1] >> (64 - shift);
+    div_2by1(rem, rem, low, norm, v);
+  }
+  return rem >> shift;
+}
+
+// Knuth's Algorithm D: q[0, an - bn + 1) = a / b, r[0, bn) = a % b for
+// an >= bn >= 2 and b[bn - 1] != 0
+inline void divmod_knuth(uint64_t *q, uint64_t *r, const uint64_t *a,
+                         uint64_t an, const uint64_t *b, uint64_t bn) {
+  const unsigned shift = std::countl_zero(b[bn - 1]);
+  std::vector<uint64_t> scratch(an + 1 + bn);
+  uint64_t *un = scratch.data(), *vn = un + an + 1;
+  if (shift) {
+    lshift(vn, b, bn, shift);
+    un[an] = lshift(un, a, an, shift);
+  } else {
+    std::copy(b, b + bn, vn);
+    std::copy(a, a + an, un);
+    un[an] = 0;
+  }
+
+  const uint64_t d1 = vn[bn - 1], d0 = vn[bn - 2], v = reciprocal(d1);
+  for (uint64_t j = an - bn + 1; j-- > 0;) {
+    const uint64_t u2 = un[j + bn], u1 = un[j + bn - 1], u0 = un[j + bn - 2];
+    uint64_t qhat = ~0ull;
+    if (u2 < d1) {
+      uint64_t rhat;
+      qhat = div_2by1(rhat, u2, u1, d1, v);
+      while (static_cast<__uint128_t>(qhat) * d0 >
+             ((static_cast<__uint128_t>(rhat) << 64) | u0)) {
+        --qhat;
+        rhat += d1;
+        if (rhat < d1)
+          break;
+      }
+    }
+    const uint64_t borrow = submul_1(un + j, vn, bn, qhat);
+    const uint64_t top = un[j + bn];
+    un[j + bn] = top - borrow;
+    if (top < borrow) {
+      --qhat;
+      un[j + bn] += add_n(un + j, un + j, vn, bn);
+    }
+    q[j] = qhat;
+  }
+
+  if (shift)
+    rshift(r, un, bn, shift);
+  else
+    std::copy(un, un + bn, r);
+}
+
+namespace detail {
+
+// Burnikel-Ziegler 2n / n step: q[0, n) = a / b and r[0, n) = a % b for
+// a[0, 2n) < b * B^n and a normalized b
+inline void bz_div_2n_1n(uint64_t *q, uint64_t *r, const uint64_t *a,
+                         const uint64_t *b, uint64_t n);
+
+// Burnikel-Ziegler 3h / 2h step: q[0, h) = a / b and r[0, 2h) = a % b for
+// a[0, 3h) < b * B^h and a normalized b[0, 2h)
+inline void bz_div_3n_2n(uint64_t *q, uint64_t *r, const uint64_t *a,
+                         const uint64_t *b, uint64_t h) {
+  const uint64_t *a1 = a + 2 * h, *b1 = b + h;
+  // r_hat holds r1 * B^h + a3 with one spare limb
+  std::vector<uint64_t> scratch(2 * h + 1 + 2 * h);
+  uint64_t *r_hat = scratch.data(), *d = r_hat + 2 * h + 1;
+
+  std::copy(a, a + h, r_hat);
+  if (cmp(a1, b1, h) < 0) {
+    bz_div_2n_1n(q, r_hat + h, a + h, b1, h);
+    r_hat[2 * h] = 0;
+  } else {
+    // a1 == b1 here, so q = B^h - 1 and r1 = <a1, a2> - q * b1 = a2 + b1
+    std::fill(q, q + h, ~0ull);
+    r_hat[2 * h] = add_n(r_hat + h, a + h, b1, h);
+  }
+
+  mul(d, q, h, b, h);
+  // r_hat -= d, adding b back while the difference is negative
+  uint64_t borrow = sub(r_hat, r_hat, 2 * h + 1, d, 2 * h);
+  while (borrow) {
+    sub_1(q, q, h, 1);
+    borrow -= add(r_hat, r_hat, 2 * h + 1, b, 2 * h);
+  }
+  std::copy(r_hat, r_hat + 2 * h, r);
+}
+
+inline void bz_div_2n_1n(uint64_t *q, uint64_t *r, const uint64_t *a,
+                         const uint64_t *b, uint64_t n) {
+  if (n % 2 || n < BURNIKEL_ZIEGLER_BASECASE) {
+    std::vector<uint64_t> quotient(n + 1);
+    divmod_knuth(quotient.data(), r, a, 2 * n, b, n);
+    std::copy(quotient.data(), quotient.data() + n, q);
+    return;
+  }
+  const uint64_t h = n / 2;
+  std::vector<uint64_t> scratch(3 * h);
+  std::copy(a, a + h, scratch.data());
+  bz_div_3n_2n(q + h, scratch.data() + h, a + h, b, h);
+  bz_div_3n_2n(q, r, scratch.data(), b, h);
+}
+
+// Block-wise Burnikel-Ziegler division, same contract as divmod
+inline void divmod_burnikel_ziegler(uint64_t *q, uint64_t *r, const uint64_t *a,
+                                    uint64_t an, const uint64_t *b,
+                                    uint64_t bn) {
+  // Block size n = k * 2^t >= bn with k <= threshold keeps every recursion
+  // level even-sized down to the Knuth base case
+  uint64_t levels = 0;
+  while (((bn + (1ull << levels) - 1) >> levels) > BURNIKEL_ZIEGLER_BASECASE)
+    ++levels;
+  const uint64_t n = ((bn + (1ull << levels) - 1) >> levels) << levels;
+  const uint64_t limb_shift = n - bn;
+  const unsigned bit_shift = std::countl_zero(b[bn - 1]);
+
+  std::vector<uint64_t> divisor(n, 0);
+  std::copy(b, b + bn, divisor.data() + limb_shift);
+  if (bit_shift)
+    lshift(divisor.data(), divisor.data(), n, bit_shift);
+
+  // Enough n-limb blocks that the top one is below the divisor
+  const uint64_t shifted_limbs = an + limb_shift + 1;
+  uint64_t blocks = std::max<uint64_t>(2, (shifted_limbs + n - 1) / n);
+  std::vector<uint64_t> dividend(blocks * n, 0);
+  std::copy(a, a + an, dividend.data() + limb_shift);
+  if (bit_shift)
+    lshift(dividend.data(), dividend.data(), blocks * n, bit_shift);
+  if (dividend[blocks * n - 1] >> 63) {
+    ++blocks;
+    dividend.resize(blocks * n, 0);
+  }
+
+  std::vector<uint64_t> scratch(5 * n);
+  uint64_t *z = scratch.data(), *rem = z + 2 * n, *quotient = rem + n;
+  std::copy(dividend.data() + (blocks - 2) * n, dividend.data() + blocks * n,
+            z);
+  std::vector<uint64_t> full_quotient((blocks - 1) * n);
+  for (uint64_t block = blocks - 1; block-- > 0;) {
+    bz_div_2n_1n(quotient, rem, z, divisor.data(), n);
+    std::copy(quotient, quotient + n, full_quotient.data() + block * n);
+    if (block > 0) {
+      std::copy(dividend.data() + (block - 1) * n, dividend.data() + block * n,
+                z);
+      std::copy(rem, rem + n, z + n);
+    }
+  }
+
+  std::copy(full_quotient.data(), full_quotient.data() + (an - bn + 1), q);
+  if (bit_shift)
+    rshift(rem, rem, n, bit_shift);
+  std::copy(rem + limb_shift, rem + n, r);
+}
+
+} // namespace detail
+
+// q[0, an - bn + 1) = a / b, r[0, bn) = a % b for an >= bn >= 1 and
+// b[bn - 1] != 0. q and r must not overlap the operands.
+inline void divmod(uint64_t *q, uint64_t *r, const uint64_t *a, uint64_t an,
+                   const uint64_t *b, uint64_t bn) {
+  if (bn == 1)
+    r[0] = divmod_1(q, a, an, b[0]);
+  else if (bn < BURNIKEL_ZIEGLER_THRESHOLD ||
+           an - bn < BURNIKEL_ZIEGLER_THRESHOLD)
+    divmod_knuth(q, r, a, an, b, bn);
+  else
+    detail::divmod_burnikel_ziegler(q, r, a, an, b, bn);
+}
+
+} // namespace bits::limbs
+
+#endif // !LIMBS_HPP
@@ -0,0 +1,123 @@
+#pragma once
+#ifndef MAPPING_HPP
+#define MAPPING_HPP
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPING_HAS_MMAP 1
+#endif
+
+namespace mapping {
+
+// A whole file mapped read-only. Where mmap is unavailable the file is read
+// into memory instead, so callers see the same interface either way.
+class fileMapping {
+  const std::byte *mData = nullptr;
+  uint64_t mSize = 0;
+  std::vector<std::byte> mCopy; // only without mmap
+
+public:
+  explicit fileMapping(const std::string &path) {
+#ifdef MAPPING_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("Cannot open " + path);
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Cannot read the size of " + path);
+    }
+    mSize = static_cast<uint64_t>(info.st_size);
+    if (mSize > 0) {
+      void *address = ::mmap(nullptr, mSize, PROT_READ, MAP_SHARED, fd, 0);
+      if (address == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Cannot map " + path);
+      }
+      mData = static_cast<const std::byte *>(address);
+    }
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+      throw std::runtime_error("Cannot open " + path);
+    mCopy.resize(static_cast<uint64_t>(in.tellg()));
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char *>(mCopy.data()),
+                 static_cast<std::streamsize>(mCopy.size())))
+      throw std::runtime_error("Cannot read " + path);
+    mData = mCopy.data();
+    mSize = mCopy.size();
+#endif
+  }
+
+  fileMapping(const fileMapping &) = delete;
+  fileMapping &operator=(const fileMapping &) = delete;
+
+  ~fileMapping() {
+#ifdef MAPPING_HAS_MMAP
+    if (mData)
+      ::munmap(const_cast<std::byte *>(mData), mSize);
+#endif
+  }
+
+  [[nodiscard]] const std::byte *data() const { return mData; }
+  [[nodiscard]] uint64_t size() const { return mSize; }
+};
+
+// Array that either owns its elements or views part of a shared file
+// mapping. Copies of a mapped array share the mapping; the first call to
+// owned() copies the elements out so they can be changed.
+template <typename T> class tableArray {
+  std::vector<T> mOwned;
+  std::shared_ptr<const fileMapping> mMapping;
+  const T *mView = nullptr;
+  uint64_t mViewSize = 0;
+
+public:
+  tableArray() = default;
+  explicit tableArray(uint64_t count) : mOwned(count) {}
+  // count elements of mapping starting at byte offset
+  tableArray(std::shared_ptr<const fileMapping> mapping, uint64_t offset,
+             uint64_t count)
+      : mMapping(std::move(mapping)),
+        mView(reinterpret_cast<const T *>(mMapping->data() + offset)),
+        mViewSize(count) {}
+
+  [[nodiscard]] bool mapped() const { return mMapping != nullptr; }
+  [[nodiscard]] const T *data() const {
+    return mMapping ? mView : mOwned.data();
+  }
+  [[nodiscard]] uint64_t size() const {
+    return mMapping ? mViewSize : mOwned.size();
+  }
+  [[nodiscard]] const T &operator[](uint64_t idx) const { return data()[idx]; }
+  [[nodiscard]] const T *begin() const { return data(); }
+  [[nodiscard]] const T *end() const { return data() + size(); }
+
+  std::vector<T> &owned() {
+    if (mMapping) {
+      mOwned.assign(mView, mView + mViewSize);
+      mMapping.reset();
+      mView = nullptr;
+      mViewSize = 0;
+    }
+    return mOwned;
+  }
+};
+
+} // namespace mapping
+
+#endif // !MAPPING_HPP
@@ -0,0 +1,228 @@
+#pragma once
+#ifndef MONTGOMERY_HPP
+#define MONTGOMERY_HPP
+
+#include "bits.hpp"
+#include "limbs.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace bits {
+
+// Montgomery arithmetic modulo a fixed odd N with R = 2^(64 * blocks(N)).
+// Build it once per modulus and reuse it for every reduction.
+class MontgomeryContext {
+private:
+  uint64_t mBlocks;
+  uint64_t mInverse; // -N^-1 mod 2^64
+  std::vector<uint64_t> mModulus;
+  std::vector<uint64_t> mR2;  // R^2 mod N
+  std::vector<uint64_t> mOne; // R mod N, one in Montgomery form
+
+  static uint64_t negated_inverse(uint64_t odd) {
+    return 0 - limbs::inverse_word(odd);
+  }
+
+  // r -= N when the (n + 1)-limb value <r, top> is not below N
+  void final_subtract(uint64_t *r, uint64_t top) const {
+    if (top || limbs::cmp(r, mModulus.data(), mBlocks) >= 0)
+      limbs::sub_n(r, r, mModulus.data(), mBlocks);
+  }
+
+  // Reduces t[0, 2n] (with t[2n] spare) into r[0, n): r = t / R mod N
+  void redc(uint64_t *r, uint64_t *t) const {
+    const uint64_t n = mBlocks;
+    for (uint64_t idx = 0; idx < n; ++idx) {
+      uint64_t m = t[idx] * mInverse;
+      uint64_t carry = limbs::addmul_1(t + idx, mModulus.data(), n, m);
+      limbs::add_1(t + idx + n, t + idx + n, n + 1 - idx, carry);
+    }
+    std::copy_n(t + n, n, r);
+    final_subtract(r, t[2 * n]);
+  }
+
+public:
+  explicit MontgomeryContext(const container &modulus)
+      : mBlocks(limbs::normalize(modulus.data(), modulus.blocks())) {
+    if (mBlocks == 0 || !(modulus.data()[0] & 1)) {
+      throw std::invalid_argument("Montgomery modulus must be odd");
+    }
+    mModulus.assign(modulus.data(), modulus.data() + mBlocks);
+    mInverse = negated_inverse(mModulus[0]);
+
+    container r2 = (container(1) << (128 * mBlocks)) % modulus;
+    mR2.assign(mBlocks, 0);
+    std::copy_n(r2.data(), std::min(r2.blocks(), mBlocks), mR2.data());
+
+    std::vector<uint64_t> one(mBlocks, 0), scratch(scratch_blocks());
+    one[0] = 1;
+    mOne.assign(mBlocks, 0);
+    multiply(mOne.data(), mR2.data(), one.data(), scratch.data());
+  }
+
+  [[nodiscard]] uint64_t blocks() const { return mBlocks; }
+
+  [[nodiscard]] container modulus() const {
+    return container::from_blocks(mModulus.data(), mBlocks);
+  }
+
+  // Limbs of scratch space the limb-level operations below need
+  [[nodiscard]] uint64_t scratch_blocks() const { return 2 * mBlocks + 2; }
+
+  // Limb-level CIOS product r = a * b / R mod N. Operands hold n limbs
+  // below N, r may alias either of them.
+  void multiply(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                uint64_t *scratch) const {
+    const uint64_t n = mBlocks;
+    // Each round works on the window t[idx, idx + n + 2) so the division by
+    // 2^64 is a pointer increment instead of a shift
+    uint64_t *t = scratch;
+    std::fill_n(t, 2 * n + 2, 0);
+    for (uint64_t idx = 0; idx < n; ++idx) {
+      uint64_t *window = t + idx;
+      uint64_t carry = limbs::addmul_1(window, a, n, b[idx]);
+      limbs::add_1(window + n, window + n, 2, carry);
+      uint64_t m = window[0] * mInverse;
+      carry = limbs::addmul_1(window, mModulus.data(), n, m);
+      limbs::add_1(window + n, window + n, 2, carry);
+    }
+    std::copy_n(t + n, n, r);
+    final_subtract(r, t[2 * n]);
+  }
+
+  // Limb-level r = a^2 / R mod N through the dedicated squaring kernel
+  void square(uint64_t *r, const uint64_t *a, uint64_t *scratch) const {
+    scratch[2 * mBlocks] = 0;
+    limbs::sqr(scratch, a, mBlocks);
+    redc(r, scratch);
+  }
+
+  [[nodiscard]] container to_montgomery(const container &value) const {
+    std::vector<uint64_t> reduced = load(value), result(mBlocks);
+    std::vector<uint64_t> scratch(scratch_blocks());
+    multiply(result.data(), reduced.data(), mR2.data(), scratch.data());
+    return container::from_blocks(result.data(), mBlocks);
+  }
+
+  [[nodiscard]] container from_montgomery(const container &value) const {
+    std::vector<uint64_t> reduced = load(value), one(mBlocks, 0),
+                          result(mBlocks), scratch(scratch_blocks());
+    one[0] = 1;
+    multiply(result.data(), reduced.data(), one.data(), scratch.data());
+    return container::from_blocks(result.data(), mBlocks);
+  }
+
+  // Montgomery product of two values already in Montgomery form
+  [[nodiscard]] container multiply(const container &a,
+                                   const container &b) const {
+    std::vector<uint64_t> left = load(a), right = load(b), result(mBlocks);
+    std::vector<uint64_t> scratch(scratch_blocks());
+    multiply(result.data(), left.data(), right.data(), scratch.data());
+    return container::from_blocks(result.data(), mBlocks);
+  }
+
+  [[nodiscard]] container square(const container &a) const {
+    std::vector<uint64_t> value = load(a), result(mBlocks);
+    std::vector<uint64_t> scratch(scratch_blocks());
+    square(result.data(), value.data(), scratch.data());
+    return container::from_blocks(result.data(), mBlocks);
+  }
+
+  // base^exponent mod N on ordinary (not Montgomery form) values using
+  // left-to-right sliding windows over odd powers
+  [[nodiscard]] container pow_mod(const container &base,
+                                  const container &exponent) const {
+    const uint64_t n = mBlocks;
+    const uint64_t exp_blocks =
+        limbs::normalize(exponent.data(), exponent.blocks());
+    if (exp_blocks == 0)
+      return modulus() == 1ull ? container(1, 0) : container(1);
+
+    const uint64_t exp_bits = (exp_blocks - 1) * 64 +
+                              std::bit_width(exponent.data()[exp_blocks - 1]);
+    const unsigned window = limbs::window_bits(exp_bits);
+
+    // table[i] = base^(2i + 1) in Montgomery form
+    std::vector<uint64_t> table(n << (window - 1)), square_base(n);
+    std::vector<uint64_t> scratch(scratch_blocks());
+    std::vector<uint64_t> reduced = load(base);
+    multiply(table.data(), reduced.data(), mR2.data(), scratch.data());
+    square(square_base.data(), table.data(), scratch.data());
+    for (uint64_t idx = 1; idx < (1ull << (window - 1)); ++idx)
+      multiply(table.data() + idx * n, table.data() + (idx - 1) * n,
+               square_base.data(), scratch.data());
+
+    auto bit = [&](int64_t pos) {
+      return (exponent.data()[pos / 64] >> (pos % 64)) & 1;
+    };
+    std::vector<uint64_t> result = mOne;
+    int64_t pos = static_cast<int64_t>(exp_bits) - 1;
+    while (pos >= 0) {
+      if (!bit(pos)) {
+        square(result.data(), result.data(), scratch.data());
+        --pos;
+        continue;
+      }
+      // Longest window ending in a set bit
+      int64_t low = std::max<int64_t>(pos - window + 1, 0);
+      while (!bit(low))
+        ++low;
+      uint64_t value = 0;
+      for (int64_t idx = pos; idx >= low; --idx) {
+        value = (value << 1) | bit(idx);
+        square(result.data(), result.data(), scratch.data());
+      }
+      multiply(result.data(), result.data(), table.data() + (value >> 1) * n,
+               scratch.data());
+      pos = low - 1;
+    }
+
+    std::vector<uint64_t> one(n, 0);
+    one[0] = 1;
+    multiply(result.data(), result.data(), one.data(), scratch.data());
+    return container::from_blocks(result.data(), n);
+  }
+
+private:
+  // Copies value mod N into an n-limb buffer
+  [[nodiscard]] std::vector<uint64_t> load(const container &value) const {
+    std::vector<uint64_t> result(mBlocks, 0);
+    uint64_t blocks = limbs::normalize(value.data(), value.blocks());
+    if (blocks > mBlocks ||
+        (blocks == mBlocks &&
+         limbs::cmp(value.data(), mModulus.data(), mBlocks) >= 0)) {
+      container reduced = value % modulus();
+      std::copy_n(reduced.data(), reduced.blocks(), result.data());
+    } else {
+      std::copy_n(value.data(), blocks, result.data());
+    }
+    return result;
+  }
+};
+
+// base^exponent mod modulus, through Montgomery arithmetic when the
+// modulus is odd and plain square-and-multiply otherwise
+inline container pow_mod(const container &base, const container &exponent,
+                         const container &modulus) {
+  if (modulus[0])
+    return MontgomeryContext(modulus).pow_mod(base, exponent);
+  if (modulus == 0ull)
+    throw std::invalid_argument("Division by zero");
+
+  container result(1), power = base % modulus;
+  const uint64_t exp_bits = exponent.size();
+  for (uint64_t pos = 0; pos < exp_bits; ++pos) {
+    if (exponent[pos])
+      result = (result * power) % modulus;
+    if (pos + 1 < exp_bits)
+      power = power.square() % modulus;
+  }
+  return result % modulus;
+}
+
+} // namespace bits
+
+#endif // !MONTGOMERY_HPP
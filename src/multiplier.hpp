@@ -0,0 +1,57 @@
+#pragma once
+#ifndef MULTIPLIER_HPP
+#define MULTIPLIER_HPP
+
+#include "bits.hpp"
+#include "limbs.hpp"
+#include "ntt.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace bits {
+
+// Multiplies many values by one fixed operand. Once the products reach the
+// NTT tier the operand's transform is kept between calls and only redone
+// when a product needs a different transform size.
+class FixedMultiplier {
+private:
+  std::vector<uint64_t> mOperand;
+  limbs::ntt::spectrum mSpectrum;
+
+public:
+  explicit FixedMultiplier(const container &operand)
+      : mOperand(operand.data(),
+                 operand.data() +
+                     limbs::normalize(operand.data(), operand.blocks())) {}
+
+  [[nodiscard]] container operand() const {
+    if (mOperand.empty())
+      return container(1, 0);
+    return container::from_blocks(mOperand.data(), mOperand.size());
+  }
+
+  [[nodiscard]] container multiply(const container &other) {
+    const uint64_t an = mOperand.size();
+    const uint64_t bn = limbs::normalize(other.data(), other.blocks());
+    if (an == 0 || bn == 0)
+      return container(1, 0);
+
+    std::vector<uint64_t> result(an + bn);
+    if (std::min(an, bn) < limbs::NTT_THRESHOLD) {
+      limbs::mul(result.data(), mOperand.data(), an, other.data(), bn);
+    } else {
+      const unsigned log_size = limbs::ntt::transform_log(an + bn);
+      if (mSpectrum.empty() || mSpectrum.log_size() != log_size)
+        mSpectrum = limbs::ntt::spectrum(mOperand.data(), an, log_size);
+      limbs::ntt::spectrum product(other.data(), bn, log_size);
+      product.multiply(mSpectrum);
+      product.extract(result.data(), an + bn);
+    }
+    return container::from_blocks(result.data(), result.size());
+  }
+};
+
+} // namespace bits
+
+#endif
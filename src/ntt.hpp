@@ -0,0 +1,280 @@
+#pragma once
+#ifndef NTT_HPP
+#define NTT_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "word.hpp"
+
+// Three-prime number theoretic transform multiplication. Every 64-bit limb
+// is one coefficient; the convolution is computed modulo three primes just
+// above 2^61 and recombined with Garner's algorithm, which is exact while
+// the shorter operand has fewer than 2^56 limbs.
+namespace bits::limbs::ntt {
+
+// Montgomery arithmetic modulo a prime p = c * 2^k + 1 below 2^62.
+// Field elements are kept in Montgomery form. Inside the transforms they
+// are only reduced below 2p: since 4p^2 < 2^64 p the lazy product of two
+// such values still reduces correctly, which saves most of the
+// conditional subtractions.
+struct modulus {
+  uint64_t p;
+  uint64_t inverse; // -p^-1 mod 2^64
+  uint64_t r2;      // 2^128 mod p
+  uint64_t root;    // primitive 2^max_log-th root of unity, Montgomery form
+  unsigned max_log;
+
+  // t / 2^64 mod p, below 2p, for t < 2^64 * p
+  constexpr uint64_t reduce_lazy(__uint128_t t) const {
+    uint64_t m = uint64_t(t) * inverse;
+    return uint64_t((t + __uint128_t(m) * p) >> 64);
+  }
+  constexpr uint64_t reduce(__uint128_t t) const {
+    uint64_t r = reduce_lazy(t);
+    return r >= p ? r - p : r;
+  }
+  constexpr uint64_t mul_lazy(uint64_t a, uint64_t b) const {
+    return reduce_lazy(__uint128_t(a) * b);
+  }
+  // a below 4p into [0, 2p)
+  constexpr uint64_t fold(uint64_t a) const {
+    return a >= 2 * p ? a - 2 * p : a;
+  }
+  constexpr uint64_t mul(uint64_t a, uint64_t b) const {
+    return reduce(__uint128_t(a) * b);
+  }
+  constexpr uint64_t add(uint64_t a, uint64_t b) const {
+    uint64_t r = a + b;
+    return r >= p ? r - p : r;
+  }
+  constexpr uint64_t sub(uint64_t a, uint64_t b) const {
+    return a >= b ? a - b : a + p - b;
+  }
+  // Any 64-bit value into Montgomery form
+  constexpr uint64_t to_field(uint64_t x) const { return mul(x, r2); }
+  constexpr uint64_t pow(uint64_t base, uint64_t exponent) const {
+    uint64_t result = to_field(1);
+    for (; exponent; exponent >>= 1, base = mul(base, base))
+      if (exponent & 1)
+        result = mul(result, base);
+    return result;
+  }
+};
+
+constexpr modulus make_modulus(uint64_t p, uint64_t generator) {
+  modulus m{p, 0, 0, 0, 0};
+  m.inverse = 0 - inverse_word(p);
+  __uint128_t r = (__uint128_t(1) << 64) % p;
+  m.r2 = uint64_t(r * r % p);
+  m.max_log = std::countr_zero(p - 1);
+  m.root = m.pow(m.to_field(generator), (p - 1) >> m.max_log);
+  return m;
+}
+
+constexpr modulus PRIMES[3] = {
+    make_modulus((29ull << 57) + 1, 3),
+    make_modulus((69ull << 55) + 1, 5),
+    make_modulus((163ull << 54) + 1, 3),
+};
+
+// Twiddle factors for every stage up to the largest transform seen so far:
+// entry half + j holds w^j where w is a primitive (2 * half)-th root. The
+// layout does not depend on the transform size, so the table only grows.
+inline const uint64_t *roots(unsigned prime, unsigned log_size, bool inverse) {
+  thread_local std::vector<uint64_t> tables[3][2];
+  std::vector<uint64_t> &table = tables[prime][inverse];
+  const uint64_t size = uint64_t(1) << log_size;
+  if (table.size() >= size)
+    return table.data();
+
+  const modulus &m = PRIMES[prime];
+  // Stages below the current size are already in place
+  uint64_t first = std::max<uint64_t>(table.size(), 1);
+  table.resize(size);
+  for (uint64_t half = first; half < size; half *= 2) {
+    unsigned len_log = std::countr_zero(half) + 1;
+    uint64_t w = m.pow(m.root, uint64_t(1) << (m.max_log - len_log));
+    if (inverse)
+      w = m.pow(w, (uint64_t(2) * half) - 1);
+    table[half] = m.to_field(1);
+    for (uint64_t j = 1; j < half; ++j)
+      table[half + j] = m.mul(table[half + j - 1], w);
+  }
+  return table.data();
+}
+
+// Decimation in frequency: natural order in, bit-reversed order out.
+// Values stay below 2p.
+inline void forward(uint64_t *a, unsigned log_size, unsigned prime) {
+  const modulus &m = PRIMES[prime];
+  const uint64_t *w = roots(prime, log_size, false);
+  const uint64_t size = uint64_t(1) << log_size;
+  for (uint64_t half = size / 2; half >= 1; half /= 2) {
+    for (uint64_t start = 0; start < size; start += 2 * half) {
+      uint64_t *lo = a + start, *hi = lo + half;
+      for (uint64_t j = 0; j < half; ++j) {
+        uint64_t u = lo[j], v = hi[j];
+        lo[j] = m.fold(u + v);
+        hi[j] = m.mul_lazy(u + 2 * m.p - v, w[half + j]);
+      }
+    }
+  }
+}
+
+// Decimation in time: bit-reversed order in, natural order out, unscaled.
+// Values stay below 2p.
+inline void inverse(uint64_t *a, unsigned log_size, unsigned prime) {
+  const modulus &m = PRIMES[prime];
+  const uint64_t *w = roots(prime, log_size, true);
+  const uint64_t size = uint64_t(1) << log_size;
+  for (uint64_t half = 1; half < size; half *= 2) {
+    for (uint64_t start = 0; start < size; start += 2 * half) {
+      uint64_t *lo = a + start, *hi = lo + half;
+      for (uint64_t j = 0; j < half; ++j) {
+        uint64_t u = lo[j], v = m.mul_lazy(hi[j], w[half + j]);
+        lo[j] = m.fold(u + v);
+        hi[j] = m.fold(u + 2 * m.p - v);
+      }
+    }
+  }
+}
+
+// Smallest transform that holds the rn - 1 coefficients of a product with
+// rn limbs
+inline unsigned transform_log(uint64_t rn) {
+  return std::bit_width(std::max<uint64_t>(rn - 1, 2) - 1);
+}
+
+// Forward transforms of one operand modulo all three primes. A spectrum can
+// be multiplied into any other of the same transform size, so an operand
+// used repeatedly (or squared) is only transformed once.
+class spectrum {
+private:
+  std::vector<uint64_t> mData; // three residue vectors of 2^mLog entries
+  unsigned mLog = 0;
+
+  uint64_t *residues(unsigned prime) {
+    return mData.data() + (uint64_t(prime) << mLog);
+  }
+  const uint64_t *residues(unsigned prime) const {
+    return mData.data() + (uint64_t(prime) << mLog);
+  }
+
+public:
+  spectrum() = default;
+
+  spectrum(const uint64_t *a, uint64_t n, unsigned log_size)
+      : mData(uint64_t(3) << log_size), mLog(log_size) {
+    const uint64_t size = uint64_t(1) << log_size;
+    for (unsigned prime = 0; prime < 3; ++prime) {
+      const modulus &m = PRIMES[prime];
+      uint64_t *x = residues(prime);
+      for (uint64_t idx = 0; idx < n; ++idx)
+        x[idx] = m.to_field(a[idx]);
+      std::fill(x + n, x + size, 0);
+      forward(x, log_size, prime);
+    }
+  }
+
+  [[nodiscard]] bool empty() const { return mData.empty(); }
+  [[nodiscard]] unsigned log_size() const { return mLog; }
+
+  // Pointwise product with a spectrum of the same size
+  void multiply(const spectrum &other) {
+    const uint64_t size = uint64_t(1) << mLog;
+    for (unsigned prime = 0; prime < 3; ++prime) {
+      const modulus &m = PRIMES[prime];
+      uint64_t *x = residues(prime);
+      const uint64_t *y = other.residues(prime);
+      for (uint64_t idx = 0; idx < size; ++idx)
+        x[idx] = m.mul_lazy(x[idx], y[idx]);
+    }
+  }
+
+  void square() { multiply(*this); }
+
+  // Inverse transforms in place and carries the coefficients into
+  // r[0, rn). The spectrum is consumed.
+  void extract(uint64_t *r, uint64_t rn) {
+    const uint64_t size = uint64_t(1) << mLog;
+    const uint64_t count = std::min(size, rn);
+    for (unsigned prime = 0; prime < 3; ++prime) {
+      const modulus &m = PRIMES[prime];
+      uint64_t *x = residues(prime);
+      inverse(x, mLog, prime);
+      // Multiplying by the plain 1 / size also leaves Montgomery form
+      uint64_t scale = m.p - (m.p - 1) / size;
+      for (uint64_t idx = 0; idx < count; ++idx)
+        x[idx] = m.mul(x[idx], scale);
+    }
+
+    const modulus &m1 = PRIMES[0], &m2 = PRIMES[1], &m3 = PRIMES[2];
+    // Garner constants, in Montgomery form so that mul() yields plain values
+    constexpr uint64_t inv12 = m2.pow(m2.to_field(m1.p % m2.p), m2.p - 2);
+    constexpr uint64_t inv13 = m3.pow(m3.to_field(m1.p % m3.p), m3.p - 2);
+    constexpr uint64_t inv23 = m3.pow(m3.to_field(m2.p % m3.p), m3.p - 2);
+    constexpr __uint128_t p12 = __uint128_t(m1.p) * m2.p;
+    const uint64_t *x1 = residues(0), *x2 = residues(1), *x3 = residues(2);
+
+    uint64_t carry0 = 0, carry1 = 0;
+    for (uint64_t idx = 0; idx < rn; ++idx) {
+      uint64_t limb = 0;
+      if (idx < count) {
+        // Value = v1 + v2 p1 + v3 p1 p2, each digit below its prime
+        uint64_t v1 = x1[idx];
+        uint64_t v2 = m2.mul(m2.sub(x2[idx], v1 >= m2.p ? v1 - m2.p : v1),
+                             inv12);
+        uint64_t v3 = m3.sub(m3.mul(m3.sub(x3[idx], v1 >= m3.p ? v1 - m3.p
+                                                                : v1),
+                                    inv13),
+                             v2 >= m3.p ? v2 - m3.p : v2);
+        v3 = m3.mul(v3, inv23);
+
+        __uint128_t low = __uint128_t(v3) * uint64_t(p12);
+        __uint128_t high = __uint128_t(v3) * uint64_t(p12 >> 64) + (low >> 64);
+        __uint128_t y = __uint128_t(v2) * m1.p + v1;
+        __uint128_t sum0 = __uint128_t(uint64_t(low)) + uint64_t(y);
+        __uint128_t sum1 =
+            __uint128_t(uint64_t(high)) + uint64_t(y >> 64) + (sum0 >> 64);
+        uint64_t sum2 = uint64_t(high >> 64) + uint64_t(sum1 >> 64);
+
+        __uint128_t acc0 = __uint128_t(uint64_t(sum0)) + carry0;
+        __uint128_t acc1 =
+            __uint128_t(uint64_t(sum1)) + carry1 + (acc0 >> 64);
+        limb = uint64_t(acc0);
+        carry0 = uint64_t(acc1);
+        carry1 = sum2 + uint64_t(acc1 >> 64);
+      } else {
+        limb = carry0;
+        carry0 = carry1;
+        carry1 = 0;
+      }
+      r[idx] = limb;
+    }
+    mData = {};
+    mLog = 0;
+  }
+};
+
+// r[0, an + bn) = a * b
+inline void mul(uint64_t *r, const uint64_t *a, uint64_t an, const uint64_t *b,
+                uint64_t bn) {
+  const unsigned log_size = transform_log(an + bn);
+  spectrum left(a, an, log_size);
+  left.multiply(spectrum(b, bn, log_size));
+  left.extract(r, an + bn);
+}
+
+// r[0, 2n) = a * a with a single forward transform
+inline void sqr(uint64_t *r, const uint64_t *a, uint64_t n) {
+  spectrum value(a, n, transform_log(2 * n));
+  value.square();
+  value.extract(r, 2 * n);
+}
+
+} // namespace bits::limbs::ntt
+
+#endif
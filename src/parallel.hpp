@@ -0,0 +1,190 @@
+#pragma once
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+// Thread count to use when the caller asks for 0
+inline unsigned defaultThreads() {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Contiguous run of task indices owned by one worker. The owner takes tasks
+// from the front and idle workers steal the back half; both ends live in a
+// single atomic word so neither side needs a lock.
+class taskRange {
+  std::atomic<uint64_t> mBounds{0}; // begin in the low half, end in the high
+
+  static uint64_t pack(uint32_t begin, uint32_t end) {
+    return uint64_t(end) << 32 | begin;
+  }
+
+public:
+  void reset(uint32_t begin, uint32_t end) {
+    mBounds.store(pack(begin, end), std::memory_order_release);
+  }
+
+  // Owner side: takes the first task
+  bool pop(uint32_t &task) {
+    uint64_t bounds = mBounds.load(std::memory_order_acquire);
+    for (;;) {
+      uint32_t begin = uint32_t(bounds), end = uint32_t(bounds >> 32);
+      if (begin >= end)
+        return false;
+      if (mBounds.compare_exchange_weak(bounds, pack(begin + 1, end),
+                                        std::memory_order_acq_rel)) {
+        task = begin;
+        return true;
+      }
+    }
+  }
+
+  // Thief side: takes the back half (at least one task)
+  bool steal(uint32_t &begin, uint32_t &end) {
+    uint64_t bounds = mBounds.load(std::memory_order_acquire);
+    for (;;) {
+      uint32_t first = uint32_t(bounds), last = uint32_t(bounds >> 32);
+      if (first >= last)
+        return false;
+      uint32_t middle = first + (last - first) / 2;
+      if (mBounds.compare_exchange_weak(bounds, pack(first, middle),
+                                        std::memory_order_acq_rel)) {
+        begin = middle;
+        end = last;
+        return true;
+      }
+    }
+  }
+};
+
+// Fixed set of worker threads running one batch of indexed tasks at a time.
+// Tasks are split evenly up front and rebalanced by work stealing; the
+// calling thread takes part as worker 0.
+class threadPool {
+  struct batch {
+    std::function<void(unsigned)> run;
+    uint64_t generation = 0;
+  };
+
+  std::vector<std::thread> mThreads;
+  std::unique_ptr<taskRange[]> mRanges;
+  std::mutex mMutex;
+  std::condition_variable mWake, mDone;
+  batch mBatch;
+  unsigned mBusy = 0;
+  bool mStopping = false;
+
+  void work(unsigned worker) {
+    uint64_t seen = 0;
+    for (;;) {
+      std::function<void(unsigned)> run;
+      {
+        std::unique_lock lock(mMutex);
+        mWake.wait(lock,
+                   [&] { return mStopping || mBatch.generation != seen; });
+        if (mStopping)
+          return;
+        seen = mBatch.generation;
+        run = mBatch.run;
+      }
+      run(worker);
+      std::lock_guard lock(mMutex);
+      if (--mBusy == 0)
+        mDone.notify_all();
+    }
+  }
+
+public:
+  // threads == 0 uses every hardware thread
+  explicit threadPool(unsigned threads = 0)
+      : mRanges(new taskRange[threads ? threads : defaultThreads()]) {
+    const unsigned count = threads ? threads : defaultThreads();
+    mThreads.reserve(count - 1);
+    for (unsigned worker = 1; worker < count; ++worker)
+      mThreads.emplace_back([this, worker] { work(worker); });
+  }
+
+  threadPool(const threadPool &) = delete;
+  threadPool &operator=(const threadPool &) = delete;
+
+  ~threadPool() {
+    {
+      std::lock_guard lock(mMutex);
+      mStopping = true;
+    }
+    mWake.notify_all();
+    for (std::thread &thread : mThreads)
+      thread.join();
+  }
+
+  [[nodiscard]] unsigned size() const { return mThreads.size() + 1; }
+
+  // Calls body(worker, task) for every task in [0, count) and waits for all
+  // of them. worker is below size(); tasks a worker runs back to back come
+  // in increasing order. The first exception thrown by body is rethrown
+  // here once the batch has drained.
+  template <typename Body> void forEach(uint32_t count, Body &&body) {
+    const unsigned workers = size();
+    for (unsigned worker = 0; worker < workers; ++worker)
+      mRanges[worker].reset(uint64_t(count) * worker / workers,
+                            uint64_t(count) * (worker + 1) / workers);
+
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto run = [&](unsigned worker) {
+      taskRange &own = mRanges[worker];
+      for (;;) {
+        uint32_t task;
+        while (own.pop(task)) {
+          try {
+            body(worker, task);
+          } catch (...) {
+            std::lock_guard lock(error_mutex);
+            if (!error)
+              error = std::current_exception();
+          }
+        }
+        bool stolen = false;
+        for (unsigned offset = 1; offset < workers && !stolen; ++offset) {
+          uint32_t begin, end;
+          if (mRanges[(worker + offset) % workers].steal(begin, end)) {
+            own.reset(begin, end);
+            stolen = true;
+          }
+        }
+        if (!stolen)
+          return;
+      }
+    };
+
+    if (workers > 1) {
+      std::lock_guard lock(mMutex);
+      mBatch.run = run;
+      ++mBatch.generation;
+      mBusy = workers - 1;
+    }
+    mWake.notify_all();
+    run(0);
+    {
+      std::unique_lock lock(mMutex);
+      mDone.wait(lock, [&] { return mBusy == 0; });
+      mBatch.run = nullptr;
+    }
+    if (error)
+      std::rethrow_exception(error);
+  }
+};
+
+} // namespace parallel
+
+#endif // !PARALLEL_HPP
@@ -0,0 +1,160 @@
+#pragma once
+#ifndef PRIMALITY_HPP
+#define PRIMALITY_HPP
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+#include "parallel.hpp"
+#include "word.hpp"
+
+// Deterministic primality test for 64-bit numbers: trial division by a few
+// small primes, then strong probable prime tests to bases known to leave
+// no composite pseudoprime below 2^32 and 2^64 respectively. All modular
+// arithmetic is Montgomery multiplication on native words.
+namespace primality {
+
+// Montgomery arithmetic modulo an odd 64-bit N with R = 2^64. Values in
+// Montgomery form are kept fully reduced, in [0, N).
+class montgomery64 {
+  uint64_t mModulus;
+  uint64_t mInverse; // N^-1 mod 2^64
+  uint64_t mOne;     // R mod N
+  uint64_t mR2;      // R^2 mod N
+
+public:
+  explicit montgomery64(uint64_t modulus) : mModulus(modulus) {
+    if (!(modulus & 1))
+      throw std::invalid_argument("Montgomery modulus must be odd");
+    mInverse = bits::limbs::inverse_word(modulus);
+    mOne = (0 - modulus) % modulus;
+    mR2 = static_cast<uint64_t>(static_cast<__uint128_t>(mOne) * mOne %
+                                modulus);
+  }
+
+  [[nodiscard]] uint64_t modulus() const { return mModulus; }
+  [[nodiscard]] uint64_t one() const { return mOne; }
+
+  // t / R mod N for t < N * 2^64. The low words of t and m * N agree, so
+  // only the high words are subtracted; no 129-bit intermediate appears
+  // even when N is above 2^63.
+  [[nodiscard]] uint64_t reduce(__uint128_t t) const {
+    uint64_t m = static_cast<uint64_t>(t) * mInverse;
+    uint64_t high = static_cast<uint64_t>(t >> 64);
+    uint64_t mn = static_cast<uint64_t>(
+        (static_cast<__uint128_t>(m) * mModulus) >> 64);
+    return high >= mn ? high - mn : high - mn + mModulus;
+  }
+
+  [[nodiscard]] uint64_t multiply(uint64_t a, uint64_t b) const {
+    return reduce(static_cast<__uint128_t>(a) * b);
+  }
+  [[nodiscard]] uint64_t add(uint64_t a, uint64_t b) const {
+    uint64_t sum = a + b;
+    return sum < a || sum >= mModulus ? sum - mModulus : sum;
+  }
+  [[nodiscard]] uint64_t toMontgomery(uint64_t value) const {
+    return multiply(value % mModulus, mR2);
+  }
+  [[nodiscard]] uint64_t fromMontgomery(uint64_t value) const {
+    return reduce(value);
+  }
+
+  // base^exponent with base and result in Montgomery form
+  [[nodiscard]] uint64_t pow(uint64_t base, uint64_t exponent) const {
+    uint64_t result = mOne;
+    for (; exponent; exponent >>= 1) {
+      if (exponent & 1)
+        result = multiply(result, base);
+      base = multiply(base, base);
+    }
+    return result;
+  }
+
+  // Strong probable prime test of N (odd, N - 1 = d 2^s) to the given
+  // base, which must not be a multiple of N
+  [[nodiscard]] bool strongProbablePrime(uint64_t base) const {
+    const uint64_t minus_one = mModulus - mOne;
+    const uint64_t odd = mModulus - 1;
+    const unsigned s = std::countr_zero(odd);
+    uint64_t x = pow(toMontgomery(base), odd >> s);
+    if (x == mOne || x == minus_one)
+      return true;
+    for (unsigned round = 1; round < s; ++round) {
+      x = multiply(x, x);
+      if (x == minus_one)
+        return true;
+    }
+    return false;
+  }
+};
+
+// Small primes tried before any exponentiation
+constexpr std::array<uint64_t, 15> TRIAL_PRIMES = {
+    3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
+// Bases with no strong pseudoprime below 2^32 (Jaeschke) and below 2^64
+// (Sinclair)
+constexpr std::array<uint64_t, 3> BASES_32 = {2, 7, 61};
+constexpr std::array<uint64_t, 7> BASES_64 = {
+    2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+
+// Decides the numbers trial division settles: returns 1 for prime, 0 for
+// composite and -1 when a probable prime test is needed
+inline int trialDivision(uint64_t number) {
+  if (number < 64)
+    return (0x28208a20a08a28acull >> number) & 1;
+  if (!(number & 1))
+    return 0;
+  for (uint64_t prime : TRIAL_PRIMES)
+    if (number % prime == 0)
+      return 0;
+  return number < 59 * 59 ? 1 : -1;
+}
+
+// The remaining bases once the base-2 test has passed
+inline bool otherBases(const montgomery64 &field) {
+  const uint64_t number = field.modulus();
+  auto passes = [&](uint64_t base) {
+    base %= number;
+    return base == 0 || field.strongProbablePrime(base);
+  };
+  if (number >> 32 == 0)
+    return std::all_of(BASES_32.begin() + 1, BASES_32.end(), passes);
+  return std::all_of(BASES_64.begin() + 1, BASES_64.end(), passes);
+}
+
+inline bool isPrime(uint64_t number) {
+  if (int known = trialDivision(number); known >= 0)
+    return known;
+  const montgomery64 field(number);
+  return field.strongProbablePrime(2) && otherBases(field);
+}
+
+// Tests every number, writing the answers to results (of the same size).
+// Large batches are split into blocks shared out over a thread pool;
+// threads == 0 uses every hardware thread.
+inline void isPrime(std::span<const uint64_t> numbers, std::span<bool> results,
+                    unsigned threads = 1) {
+  if (results.size() != numbers.size())
+    throw std::invalid_argument("Need one result per number");
+  constexpr uint64_t BLOCK = 4096;
+  auto test = [&](uint64_t first, uint64_t last) {
+    for (uint64_t idx = first; idx < last; ++idx)
+      results[idx] = isPrime(numbers[idx]);
+  };
+  if (threads == 1 || numbers.size() <= BLOCK)
+    return test(0, numbers.size());
+  parallel::threadPool pool(threads);
+  pool.forEach(static_cast<uint32_t>((numbers.size() + BLOCK - 1) / BLOCK),
+               [&](unsigned, uint32_t block) {
+                 test(block * BLOCK,
+                      std::min<uint64_t>((block + 1) * BLOCK, numbers.size()));
+               });
+}
+
+} // namespace primality
+
+#endif // !PRIMALITY_HPP
@@ -0,0 +1,349 @@
+#pragma once
+#ifndef PRIMECOUNT_HPP
+#define PRIMECOUNT_HPP
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "parallel.hpp"
+#include "sieve.hpp"
+
+// Prime counting beyond what a table can hold, by the Lagarias-Miller-
+// Odlyzko method with the leaf splitting of Deleglise and Rivat:
+//
+//   pi(x) = phi(x, a) + a - 1 - P2(x, a),   a = pi(y),  x^(1/3) <= y
+//
+// phi(x, a) counts the numbers up to x free of the first a primes and is
+// expanded into ordinary leaves S1 and special leaves S2. Most special
+// leaves are answered from the pi table below y; the rest ("hard" leaves)
+// by a segmented sieve of [1, x / y) that keeps a Fenwick tree of the
+// survivors. P2 counts the numbers up to x with two prime factors above y
+// by counting primes up to x / y in segments. Time is about
+// O(x^(2/3) log x), memory O(y) for the tables plus one segment.
+
+// Largest r with r * r * r <= n
+inline uint64_t icbrt(uint64_t n) {
+  uint64_t root = static_cast<uint64_t>(std::cbrt(static_cast<double>(n)));
+  while (root > 0 && root * root * root > n)
+    --root;
+  while ((root + 1) * (root + 1) * (root + 1) <= n)
+    ++root;
+  return root;
+}
+
+class primeCounter {
+  // The first C primes are removed from every sieve segment up front;
+  // phi(u, C) itself comes from a table over one period of them
+  static constexpr unsigned C = 6;
+  static constexpr uint64_t PRIMORIAL = 2 * 3 * 5 * 7 * 11 * 13;
+  // Below this a plain sieve is faster than setting up the tables
+  static constexpr uint64_t SIEVE_LIMIT = 1000000;
+
+  uint64_t mX, mY, mZ, mSqrtX, mSqrtY;
+  unsigned mThreads;
+  std::vector<uint32_t> mPrimes; // primes up to y, mPrimes[b] = p_(b+1)
+  std::vector<uint32_t> mPi;     // pi(n) for n <= y
+  std::vector<uint32_t> mLeast;  // least prime factor, n <= y
+  std::vector<int8_t> mMobius;   // mu(n), n <= y
+  std::vector<uint16_t> mPhiTable; // phi(r, C) for r < PRIMORIAL
+
+  [[nodiscard]] uint64_t phiC(uint64_t u) const {
+    return u / PRIMORIAL * mPhiTable[PRIMORIAL - 1] + mPhiTable[u % PRIMORIAL];
+  }
+
+  // Counts of survivors of a sieve segment with prefix sums by Fenwick tree
+  class fenwick {
+    std::vector<uint32_t> mTree;
+
+  public:
+    // Builds the tree over the set bits of alive[0, size)
+    void build(const std::vector<uint64_t> &alive, uint64_t size) {
+      mTree.assign(size, 0);
+      for (uint64_t idx = 0; idx < size; ++idx) {
+        mTree[idx] += (alive[idx / 64] >> (idx % 64)) & 1;
+        if (uint64_t parent = idx | (idx + 1); parent < size)
+          mTree[parent] += mTree[idx];
+      }
+    }
+    void remove(uint64_t idx) {
+      for (; idx < mTree.size(); idx |= idx + 1)
+        --mTree[idx];
+    }
+    // Survivors in [0, idx]
+    [[nodiscard]] uint64_t prefix(uint64_t idx) const {
+      uint64_t sum = 0;
+      for (uint64_t end = idx + 1; end > 0; end &= end - 1)
+        sum += mTree[end - 1];
+      return sum;
+    }
+  };
+
+  // Ordinary leaves: sum of mu(n) phi(x / n, C) over n <= y whose prime
+  // factors all exceed p_C
+  [[nodiscard]] __int128_t ordinaryLeaves() const {
+    __int128_t sum = 0;
+    for (uint64_t n = 1; n <= mY; ++n)
+      if (mMobius[n] && mLeast[n] > mPrimes[C - 1])
+        sum += mMobius[n] * static_cast<__int128_t>(phiC(mX / n));
+    return sum;
+  }
+
+  // Special leaves -mu(m) phi(x / (q m), b) with q = p_(b+1) > sqrt(y),
+  // whose m are primes above q, that need no sieving: phi is 1 where
+  // x / (q m) < q and pi(x / (q m)) - b + 1 where it is at most y
+  [[nodiscard]] __int128_t easyLeaves() const {
+    __int128_t sum = 0;
+    for (uint64_t b = std::max<uint64_t>(C, mPi[mSqrtY]); b < mPrimes.size();
+         ++b) {
+      const uint64_t q = mPrimes[b];
+      const uint64_t trivial = std::max(q, mX / q / q);
+      if (trivial < mY)
+        sum += mPi[mY] - mPi[trivial];
+      const uint64_t low = std::max(q, mX / q / (mY + 1));
+      const uint64_t high = std::min(mY, mX / q / q);
+      if (low < high)
+        for (uint64_t idx = mPi[low]; idx < mPi[high]; ++idx)
+          sum += mPi[mX / q / mPrimes[idx]] - b + 1;
+    }
+    return sum;
+  }
+
+  // Hard leaves and the survivor counts of one run of sieve segments
+  struct segmentResult {
+    __int128_t sum = 0;          // leaves, counting phi from the run's start
+    std::vector<int64_t> signs;  // sum of -mu(m) over the leaves of each b
+    std::vector<uint64_t> alive; // survivors of each stage b in the run
+  };
+
+  // Sieves [low, high) through the stages b = C, C + 1, ... and adds up
+  // the hard leaves whose x / (q m) falls into it
+  void hardLeaves(uint64_t low, uint64_t high, segmentResult &result,
+                  std::vector<uint64_t> &alive, fenwick &tree) const {
+    const uint64_t size = high - low;
+    alive.assign((size + 63) / 64, ~uint64_t(0));
+    auto cross = [&](uint64_t prime, bool update) {
+      // Even numbers are gone after stage 1, so odd multiples suffice
+      uint64_t multiple = std::max(prime, (low + prime - 1) / prime * prime);
+      uint64_t step = prime == 2 ? 2 : 2 * prime;
+      if (prime != 2 && !(multiple & 1))
+        multiple += prime;
+      for (uint64_t idx = multiple - low; idx < size; idx += step) {
+        uint64_t bit = uint64_t(1) << (idx % 64);
+        if (alive[idx / 64] & bit) {
+          alive[idx / 64] &= ~bit;
+          if (update)
+            tree.remove(idx);
+        }
+      }
+    };
+    for (unsigned b = 0; b < C; ++b)
+      cross(mPrimes[b], false);
+    tree.build(alive, size);
+    uint64_t survivors = tree.prefix(size - 1);
+
+    const uint64_t last = std::max(mSqrtY, isqrt(mX / low));
+    for (uint64_t b = C; b < mPrimes.size() && mPrimes[b] <= last; ++b) {
+      const uint64_t q = mPrimes[b], xq = mX / q;
+      const uint64_t first = xq / high, final = std::min(mY, xq / low);
+      // phi(u, b) less the survivors of the runs before this one
+      auto leaf = [&](uint64_t m, int64_t sign) {
+        result.sum += sign * static_cast<__int128_t>(
+                                 result.alive[b] + tree.prefix(xq / m - low));
+        result.signs[b] += sign;
+      };
+      if (q <= mSqrtY) {
+        for (uint64_t m = std::max(first, mY / q) + 1; m <= final; ++m)
+          if (mMobius[m] && mLeast[m] > q)
+            leaf(m, -mMobius[m]);
+      } else {
+        // Primes m above q with x / (q m) > y; the others are easy
+        const uint64_t top = std::min(final, xq / (mY + 1));
+        const uint64_t bottom = std::max(first, q);
+        if (bottom < top)
+          for (uint64_t idx = mPi[bottom]; idx < mPi[top]; ++idx)
+            leaf(mPrimes[idx], 1);
+      }
+      result.alive[b] += survivors;
+      cross(q, true);
+      survivors = tree.prefix(size - 1);
+    }
+  }
+
+  [[nodiscard]] __int128_t hardLeaves() const {
+    const uint64_t segment = std::max<uint64_t>(
+        uint64_t(1) << 15, std::bit_ceil(isqrt(mZ) + 1));
+    const uint64_t segments = (mZ - 1 + segment - 1) / segment;
+    // Runs of consecutive segments: one per thread when sequential work
+    // allows, more to let the pool balance the uneven early segments
+    const auto runs = static_cast<uint32_t>(
+        std::min<uint64_t>(segments, mThreads == 1 ? 1 : 8 * mThreads));
+    std::vector<segmentResult> results(runs);
+    for (segmentResult &result : results) {
+      result.signs.assign(mPrimes.size(), 0);
+      result.alive.assign(mPrimes.size(), 0);
+    }
+
+    parallel::threadPool pool(mThreads);
+    pool.forEach(runs, [&](unsigned, uint32_t run) {
+      std::vector<uint64_t> alive;
+      fenwick tree;
+      for (uint64_t idx = segments * run / runs,
+                    end = segments * (run + 1) / runs;
+           idx < end; ++idx) {
+        const uint64_t low = 1 + idx * segment;
+        hardLeaves(low, std::min(low + segment, mZ), results[run], alive,
+                   tree);
+      }
+    });
+
+    // Each run counted phi from its own start; add the survivors of the
+    // runs before it
+    __int128_t sum = 0;
+    std::vector<uint64_t> before(mPrimes.size(), 0);
+    for (const segmentResult &result : results) {
+      sum += result.sum;
+      for (uint64_t b = C; b < mPrimes.size(); ++b) {
+        sum += result.signs[b] * static_cast<__int128_t>(before[b]);
+        before[b] += result.alive[b];
+      }
+    }
+    return sum;
+  }
+
+  // P2: sum of pi(x / q) - pi(q) + 1 over primes y < q <= sqrt(x)
+  [[nodiscard]] __int128_t secondPartial() const {
+    struct chunk {
+      uint64_t primes = 0; // primes in the chunk
+      uint64_t leaves = 0; // q with x / q in the chunk
+      __int128_t sum = 0;  // primes from the chunk start up to each x / q
+    };
+    const uint64_t end = mX / (mY + 1) + 1;
+    const auto chunks = static_cast<uint32_t>(std::min<uint64_t>(
+        std::max<uint64_t>(8 * mThreads, end >> 24), end));
+    std::vector<chunk> results(chunks);
+
+    parallel::threadPool pool(mThreads);
+    pool.forEach(chunks, [&](unsigned, uint32_t idx) {
+      const uint64_t lo = end * idx / chunks, hi = end * (idx + 1) / chunks;
+      chunk &result = results[idx];
+      // x / q falls into [lo, hi) for q in (x / hi, x / lo]
+      std::vector<uint64_t> bounds;
+      const uint64_t qlo = std::max(mY, mX / hi);
+      const uint64_t qhi = std::min(mSqrtX, lo ? mX / lo : mSqrtX);
+      if (qlo < qhi)
+        forEachPrime(qlo + 1, qhi + 1,
+                     [&](uint64_t q) { bounds.push_back(mX / q); });
+      std::ranges::reverse(bounds);
+      result.leaves = bounds.size();
+
+      // Every bound is at least sqrt(x), far above the presieved primes
+      for (uint64_t prime : wheel30Layout::PRESIEVED)
+        result.primes += lo <= prime && prime < hi;
+      auto next = bounds.begin();
+      segmentedSieve<wheel30Layout> engine(lo, hi);
+      while (engine.nextSegment()) {
+        const std::vector<uint64_t> &bitmap = engine.bitmap();
+        const uint64_t stop = engine.firstSlot() + engine.bitCount();
+        uint64_t word = 0, count = result.primes;
+        for (; next != bounds.end(); ++next) {
+          uint64_t slot = wheel30Layout::slotsBelow(*next + 1);
+          if (slot > stop)
+            break;
+          slot -= engine.firstSlot();
+          for (; word < slot / 64; ++word)
+            count += std::popcount(bitmap[word]);
+          uint64_t partial = 0;
+          if (slot % 64)
+            partial = std::popcount(bitmap[word] << (64 - slot % 64));
+          result.sum += count + partial;
+        }
+        for (; word < bitmap.size(); ++word)
+          count += std::popcount(bitmap[word]);
+        result.primes = count;
+      }
+      // Past the last window: the whole chunk lies below the bound
+      for (; next != bounds.end(); ++next)
+        result.sum += result.primes;
+    });
+
+    __int128_t sum = 0;
+    uint64_t below = 0, leaves = 0;
+    for (const chunk &result : results) {
+      sum += result.sum + static_cast<__int128_t>(result.leaves) * below;
+      below += result.primes;
+      leaves += result.leaves;
+    }
+    // minus the sum of pi(q) - 1 = b - 1 over b = a + 1 .. a + leaves
+    const uint64_t a = mPrimes.size();
+    sum -= static_cast<__int128_t>(2 * a + leaves - 1) * leaves / 2;
+    return sum;
+  }
+
+public:
+  // threads == 0 uses every hardware thread
+  explicit primeCounter(uint64_t x, unsigned threads = 1)
+      : mX(x), mSqrtX(isqrt(x)),
+        mThreads(threads ? threads : parallel::defaultThreads()) {
+    if (x < SIEVE_LIMIT)
+      return;
+    // y = alpha x^(1/3): a larger alpha moves work from the sieve of
+    // [1, x / y) into the leaves
+    const double alpha =
+        std::clamp(std::pow(std::log(static_cast<double>(x)), 3) / 2000,
+                   1.0, 30.0);
+    const uint64_t root = icbrt(x);
+    mY = std::clamp<uint64_t>(static_cast<uint64_t>(alpha * root), root + 1,
+                              mSqrtX);
+    mZ = mX / mY + 1; // every special leaf asks for phi below z
+    mSqrtY = isqrt(mY);
+
+    const sieve small(mY + 1);
+    mPi.resize(mY + 1);
+    for (uint64_t prime = 2; prime && prime <= mY; prime = small.next(prime))
+      mPrimes.push_back(static_cast<uint32_t>(prime));
+    for (uint64_t n = 2, b = 0; n <= mY; ++n) {
+      if (b < mPrimes.size() && mPrimes[b] == n)
+        ++b;
+      mPi[n] = static_cast<uint32_t>(b);
+    }
+
+    mLeast.assign(mY + 1, 0);
+    mMobius.assign(mY + 1, 1);
+    mLeast[1] = UINT32_MAX;
+    for (uint64_t prime : mPrimes) {
+      for (uint64_t n = prime; n <= mY; n += prime) {
+        if (!mLeast[n])
+          mLeast[n] = static_cast<uint32_t>(prime);
+        mMobius[n] = static_cast<int8_t>(-mMobius[n]);
+      }
+      for (uint64_t n = prime * prime; n <= mY; n += prime * prime)
+        mMobius[n] = 0;
+    }
+
+    mPhiTable.resize(PRIMORIAL);
+    for (uint64_t r = 0, count = 0; r < PRIMORIAL; ++r) {
+      if (std::none_of(mPrimes.begin(), mPrimes.begin() + C,
+                       [&](uint64_t prime) { return r % prime == 0; }))
+        ++count;
+      mPhiTable[r] = static_cast<uint16_t>(count);
+    }
+  }
+
+  // Number of primes <= x
+  [[nodiscard]] uint64_t count() const {
+    if (mX < SIEVE_LIMIT)
+      return mX < 2 ? 0 : sieve(mX + 1).primePi(mX);
+    const __int128_t phi = ordinaryLeaves() + easyLeaves() + hardLeaves();
+    return static_cast<uint64_t>(phi + mPrimes.size() - 1 - secondPartial());
+  }
+};
+
+// Number of primes <= x without a table of them; threads == 0 uses every
+// hardware thread
+inline uint64_t primePi(uint64_t x, unsigned threads = 1) {
+  return primeCounter(x, threads).count();
+}
+
+#endif // !PRIMECOUNT_HPP
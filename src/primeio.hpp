@@ -0,0 +1,183 @@
+#pragma once
+#ifndef PRIMEIO_HPP
+#define PRIMEIO_HPP
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "sieve.hpp"
+
+// Bulk export of the primes in [lo, hi), sieved window by window and
+// written through a large buffer so the stream sees a few big writes.
+
+// Buffer handed to the stream whenever it is nearly full
+class primeWriter {
+  static constexpr uint64_t BUFFER_BYTES = 1 << 20;
+  static constexpr uint64_t MAX_RECORD = 24; // room for any single record
+
+  std::ostream &mOut;
+  std::vector<char> mBuffer;
+  uint64_t mUsed = 0;
+
+public:
+  explicit primeWriter(std::ostream &out)
+      : mOut(out), mBuffer(BUFFER_BYTES) {}
+  primeWriter(const primeWriter &) = delete;
+  primeWriter &operator=(const primeWriter &) = delete;
+  ~primeWriter() { flush(); }
+
+  void flush() {
+    mOut.write(mBuffer.data(), static_cast<std::streamsize>(mUsed));
+    mUsed = 0;
+  }
+
+  // Space for one record; call commit() with the bytes actually used
+  char *reserve() {
+    if (mUsed + MAX_RECORD > mBuffer.size())
+      flush();
+    return mBuffer.data() + mUsed;
+  }
+  void commit(uint64_t bytes) { mUsed += bytes; }
+
+  // Decimal digits of value, two at a time from a lookup table
+  void decimal(uint64_t value, char separator) {
+    static constexpr char PAIRS[] = "00010203040506070809"
+                                    "10111213141516171819"
+                                    "20212223242526272829"
+                                    "30313233343536373839"
+                                    "40414243444546474849"
+                                    "50515253545556575859"
+                                    "60616263646566676869"
+                                    "70717273747576777879"
+                                    "80818283848586878889"
+                                    "90919293949596979899";
+    char digits[20];
+    char *end = digits + sizeof(digits), *first = end;
+    while (value >= 100) {
+      first -= 2;
+      std::memcpy(first, PAIRS + 2 * (value % 100), 2);
+      value /= 100;
+    }
+    if (value >= 10) {
+      first -= 2;
+      std::memcpy(first, PAIRS + 2 * value, 2);
+    } else {
+      *--first = static_cast<char>('0' + value);
+    }
+    char *out = reserve();
+    uint64_t length = end - first;
+    std::memcpy(out, first, length);
+    out[length] = separator;
+    commit(length + 1);
+  }
+
+  // LEB128: seven bits per byte, high bit set on all but the last
+  void varint(uint64_t value) {
+    char *out = reserve();
+    uint64_t length = 0;
+    while (value >= 0x80) {
+      out[length++] = static_cast<char>(value | 0x80);
+      value >>= 7;
+    }
+    out[length++] = static_cast<char>(value);
+    commit(length);
+  }
+};
+
+// Writes the primes in [lo, hi) in decimal, each followed by separator.
+// Returns how many were written.
+template <typename Layout = wheel30Layout>
+uint64_t writePrimesText(std::ostream &out, uint64_t lo, uint64_t hi,
+                         char separator = '\n') {
+  primeWriter writer(out);
+  uint64_t count = 0;
+  forEachPrime<Layout>(lo, hi, [&](uint64_t prime) {
+    writer.decimal(prime, separator);
+    ++count;
+  });
+  return count;
+}
+
+// Packed binary delta format:
+//   "PRMD", version byte, varint lo, varint hi, one varint per prime, then
+//   a 0 byte and the varint count of primes.
+// Each prime is stored as its distance from the previous one, plus one for
+// the first, which is measured from lo and may be 0. Gaps between two odd
+// primes are even and are stored halved, so nearly every prime below 10^15
+// takes a single byte. No record is 0, which leaves 0 free to end the list;
+// the trailing count lets readers tell a complete stream from a cut one.
+constexpr char PRIME_DELTA_MAGIC[4] = {'P', 'R', 'M', 'D'};
+constexpr uint8_t PRIME_DELTA_VERSION = 2;
+
+template <typename Layout = wheel30Layout>
+uint64_t writePrimesDelta(std::ostream &out, uint64_t lo, uint64_t hi) {
+  primeWriter writer(out);
+  char *header = writer.reserve();
+  std::memcpy(header, PRIME_DELTA_MAGIC, sizeof(PRIME_DELTA_MAGIC));
+  header[sizeof(PRIME_DELTA_MAGIC)] = static_cast<char>(PRIME_DELTA_VERSION);
+  writer.commit(sizeof(PRIME_DELTA_MAGIC) + 1);
+  writer.varint(lo);
+  writer.varint(hi);
+
+  uint64_t count = 0, previous = lo;
+  forEachPrime<Layout>(lo, hi, [&](uint64_t prime) {
+    uint64_t gap = prime - previous;
+    writer.varint(!count ? gap + 1 : (previous & 1) ? gap / 2 : gap);
+    previous = prime;
+    ++count;
+  });
+  writer.varint(0);
+  writer.varint(count);
+  return count;
+}
+
+// Reads a stream written by writePrimesDelta, calling callback with every
+// prime in order. Returns how many were read. Throws on a stream that is
+// cut short, whose count does not match or whose primes leave [lo, hi).
+template <typename Callback>
+uint64_t readPrimesDelta(std::istream &in, Callback &&callback) {
+  auto varint = [&](uint64_t &value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      int byte = in.get();
+      if (byte == std::istream::traits_type::eof())
+        throw std::runtime_error("Truncated prime delta stream");
+      value |= uint64_t(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return;
+    }
+    throw std::runtime_error("Malformed prime delta stream");
+  };
+
+  char header[sizeof(PRIME_DELTA_MAGIC) + 1];
+  if (!in.read(header, sizeof(header)) ||
+      std::memcmp(header, PRIME_DELTA_MAGIC, sizeof(PRIME_DELTA_MAGIC)) ||
+      static_cast<uint8_t>(header[sizeof(PRIME_DELTA_MAGIC)]) !=
+          PRIME_DELTA_VERSION)
+    throw std::runtime_error("Not a prime delta stream");
+  uint64_t lo, hi;
+  varint(lo);
+  varint(hi);
+
+  uint64_t count = 0, previous = lo, record;
+  for (varint(record); record != 0; varint(record)) {
+    const __uint128_t gap = !count             ? record - 1
+                            : (previous & 1) ? __uint128_t(2) * record
+                                             : record;
+    if (previous >= hi || gap >= hi - previous)
+      throw std::runtime_error("Prime outside the stream's range");
+    previous += static_cast<uint64_t>(gap);
+    callback(previous);
+    ++count;
+  }
+  uint64_t expected;
+  varint(expected);
+  if (expected != count)
+    throw std::runtime_error("Truncated prime delta stream");
+  return count;
+}
+
+#endif // !PRIMEIO_HPP
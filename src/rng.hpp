@@ -0,0 +1,160 @@
+#pragma once
+#ifndef RNG_HPP
+#define RNG_HPP
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <span>
+
+// Random 64-bit words for big integers. Every thread keeps its own engines,
+// seeded once from std::random_device on first use, and numbers are filled
+// a whole limb at a time. threadEngine() is a fast statistical generator;
+// threadSecureEngine() is ChaCha20 and is meant for key material.
+namespace rng {
+
+// ChaCha20 keystream as a 64-bit random engine. The state follows
+// Bernstein's original layout: four constants, a 256-bit key, a 64-bit
+// block counter and a 64-bit nonce; each block gives eight words.
+class chacha20 {
+  std::array<uint32_t, 16> mState;
+  std::array<uint32_t, 16> mBlock;
+  unsigned mUsed = 16; // 32-bit words of mBlock already handed out
+
+  static void quarterRound(std::array<uint32_t, 16> &x, int a, int b, int c,
+                           int d) {
+    x[a] += x[b];
+    x[d] = std::rotl(x[d] ^ x[a], 16);
+    x[c] += x[d];
+    x[b] = std::rotl(x[b] ^ x[c], 12);
+    x[a] += x[b];
+    x[d] = std::rotl(x[d] ^ x[a], 8);
+    x[c] += x[d];
+    x[b] = std::rotl(x[b] ^ x[c], 7);
+  }
+
+  // Next keystream block into out, advancing the counter
+  void nextBlock(std::array<uint32_t, 16> &out) {
+    out = mState;
+    for (int round = 0; round < 20; round += 2) {
+      quarterRound(out, 0, 4, 8, 12);
+      quarterRound(out, 1, 5, 9, 13);
+      quarterRound(out, 2, 6, 10, 14);
+      quarterRound(out, 3, 7, 11, 15);
+      quarterRound(out, 0, 5, 10, 15);
+      quarterRound(out, 1, 6, 11, 12);
+      quarterRound(out, 2, 7, 8, 13);
+      quarterRound(out, 3, 4, 9, 14);
+    }
+    for (int idx = 0; idx < 16; ++idx)
+      out[idx] += mState[idx];
+    if (++mState[12] == 0)
+      ++mState[13];
+  }
+
+public:
+  using result_type = uint64_t;
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  explicit chacha20(const std::array<uint32_t, 8> &key, uint64_t nonce = 0,
+                    uint64_t counter = 0) {
+    mState = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+    std::copy(key.begin(), key.end(), mState.begin() + 4);
+    mState[12] = static_cast<uint32_t>(counter);
+    mState[13] = static_cast<uint32_t>(counter >> 32);
+    mState[14] = static_cast<uint32_t>(nonce);
+    mState[15] = static_cast<uint32_t>(nonce >> 32);
+  }
+
+  // Key taken from a seed sequence
+  explicit chacha20(std::seed_seq &sequence) : chacha20(keyFrom(sequence)) {}
+
+  // Key taken from std::random_device
+  chacha20() : chacha20(deviceKey()) {}
+
+  static std::array<uint32_t, 8> keyFrom(std::seed_seq &sequence) {
+    std::array<uint32_t, 8> key;
+    sequence.generate(key.begin(), key.end());
+    return key;
+  }
+  static std::array<uint32_t, 8> deviceKey() {
+    std::random_device device;
+    std::array<uint32_t, 8> key;
+    for (uint32_t &word : key)
+      word = device();
+    return key;
+  }
+
+  result_type operator()() {
+    if (mUsed == 16) {
+      nextBlock(mBlock);
+      mUsed = 0;
+    }
+    const uint64_t low = mBlock[mUsed], high = mBlock[mUsed + 1];
+    mUsed += 2;
+    return high << 32 | low;
+  }
+
+  // Same words as calling operator() out.size() times; whole blocks go
+  // straight into out
+  void fill(std::span<uint64_t> out) {
+    size_t idx = 0;
+    while (idx < out.size() && mUsed != 16)
+      out[idx++] = (*this)();
+    std::array<uint32_t, 16> block;
+    for (; out.size() - idx >= 8; idx += 8) {
+      nextBlock(block);
+      for (int word = 0; word < 8; ++word)
+        out[idx + word] =
+            uint64_t(block[2 * word + 1]) << 32 | block[2 * word];
+    }
+    for (; idx < out.size(); ++idx)
+      out[idx] = (*this)();
+  }
+};
+
+// Fills out with words from engine, which must produce full 64-bit words
+template <typename Engine> void fill(Engine &engine, std::span<uint64_t> out) {
+  static_assert(Engine::min() == 0 &&
+                    Engine::max() == std::numeric_limits<uint64_t>::max(),
+                "Engine must produce 64-bit words");
+  if constexpr (requires { engine.fill(out); })
+    engine.fill(out);
+  else
+    for (uint64_t &word : out)
+      word = engine();
+}
+
+// This thread's statistical engine
+inline std::mt19937_64 &threadEngine() {
+  thread_local std::mt19937_64 engine = [] {
+    std::random_device device;
+    std::seed_seq sequence{device(), device(), device(), device(),
+                           device(), device(), device(), device()};
+    return std::mt19937_64(sequence);
+  }();
+  return engine;
+}
+
+// This thread's ChaCha20 engine, for key material
+inline chacha20 &threadSecureEngine() {
+  thread_local chacha20 engine;
+  return engine;
+}
+
+// Reseeds this thread's engines, making what they produce from here on
+// reproducible
+inline void seedThread(uint64_t seed) {
+  std::seed_seq sequence{uint32_t(seed), uint32_t(seed >> 32)};
+  threadEngine().seed(sequence);
+  threadSecureEngine() = chacha20(sequence);
+}
+
+} // namespace rng
+
+#endif // !RNG_HPP
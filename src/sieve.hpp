@@ -1,78 +1,826 @@
 #pragma once
 #ifndef SIEVE_HPP
 #define SIEVE_HPP
-#include "clampedBits.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
-class sieve {
-  clampedBits mData;
-  static void __sieve(sieve &mSieve) {
-    for (uint64_t possible_prime = 3;
-         possible_prime * possible_prime < mSieve.mData.size();
-         possible_prime += 2)
-      if (mSieve.mData.at(possible_prime))
-        for (uint64_t not_prime = possible_prime * possible_prime;
-             not_prime < mSieve.mData.size(); not_prime += 2 * possible_prime)
-          mSieve.mData.set(not_prime, 0);
+#include "mapping.hpp"
+#include "parallel.hpp"
+#include "primality.hpp"
+
+// Largest r with r * r <= n
+inline uint64_t isqrt(uint64_t n) {
+  uint64_t root = static_cast<uint64_t>(std::sqrt(static_cast<double>(n)));
+  while (root * root > n)
+    --root;
+  while ((root + 1) * (root + 1) <= n)
+    ++root;
+  return root;
+}
+
+// Odd primes up to and including limit, by a plain odd-only sieve. Only
+// used for the base primes of the segmented sieve, so limit stays small.
+inline std::vector<uint32_t> oddPrimesUpTo(uint64_t limit) {
+  std::vector<uint32_t> primes;
+  if (limit < 3)
+    return primes;
+  // composite[i] describes 2 * i + 1
+  std::vector<bool> composite(limit / 2 + 1);
+  for (uint64_t idx = 1; idx <= limit / 2; ++idx) {
+    if (composite[idx])
+      continue;
+    uint64_t prime = 2 * idx + 1;
+    primes.push_back(static_cast<uint32_t>(prime));
+    for (uint64_t multiple = prime * prime / 2; multiple <= limit / 2;
+         multiple += prime)
+      composite[multiple] = true;
+  }
+  return primes;
+}
+
+// Sieve layouts. A layout gives a bit ("slot") to every number that can be
+// prime apart from a few small primes (PRESIEVED), and knows how to cross
+// off the multiples of a base prime within a window of slots. Each 64-bit
+// word covers SPAN consecutive integers, and ID tells the layouts apart in
+// saved tables.
+//
+// oddLayout: one bit per odd number.
+struct oddLayout {
+  static constexpr uint32_t ID = 1;
+  static constexpr uint64_t SPAN = 128;
+  static constexpr std::array<uint64_t, 1> PRESIEVED = {2};
+
+  static bool hasSlot(uint64_t number) { return number & 1; }
+  static uint64_t slot(uint64_t number) { return number / 2; }
+  static uint64_t slotsBelow(uint64_t number) { return number / 2; }
+  static uint64_t value(uint64_t slot) { return 2 * slot + 1; }
+
+  // Next multiple of a base prime, as a bit of the current window
+  struct cursor {
+    uint64_t bit;
+  };
+
+  static cursor start(uint64_t prime, uint64_t window_slot) {
+    uint64_t low = value(window_slot);
+    uint64_t multiple =
+        std::max(prime * prime, (low + prime - 1) / prime * prime);
+    if (!(multiple & 1))
+      multiple += prime;
+    return {slot(multiple) - window_slot};
+  }
+
+  // Crosses off the multiples in window[0, bits) and moves the cursor to the
+  // following window, which starts bits slots later
+  static void cross(uint64_t *window, uint64_t bits, uint64_t prime,
+                    cursor &next) {
+    uint64_t bit = next.bit;
+    for (; bit < bits; bit += prime)
+      window[bit >> 6] &= ~(uint64_t(1) << (bit & 63));
+    next.bit = bit - bits;
   }
+};
+
+// wheel30Layout: one bit per number coprime to 30, so a byte holds the
+// eight candidates of 30 consecutive integers.
+struct wheel30Layout {
+  static constexpr uint32_t ID = 2;
+  static constexpr uint64_t SPAN = 240;
+  static constexpr std::array<uint64_t, 3> PRESIEVED = {2, 3, 5};
+  static constexpr std::array<uint64_t, 8> RESIDUES = {1,  7,  11, 13,
+                                                       17, 19, 23, 29};
+  // Distance from each residue to the next one
+  static constexpr std::array<uint64_t, 8> STEPS = {6, 4, 2, 4, 2, 4, 6, 2};
+  static constexpr uint8_t NONE = 0xff;
+  // Index of each residue modulo 30 in RESIDUES, or NONE
+  static constexpr std::array<uint8_t, 30> POSITION = [] {
+    std::array<uint8_t, 30> result{};
+    result.fill(NONE);
+    for (uint8_t idx = 0; idx < 8; ++idx)
+      result[RESIDUES[idx]] = idx;
+    return result;
+  }();
+
+  // For a prime p = 30 k + RESIDUES[r] and a multiple p * q with q at
+  // wheel position w: the bit the multiple occupies in its byte, and how
+  // far beyond k * STEPS[w] bytes the next multiple coprime to 30 lies
+  struct pattern {
+    uint8_t mask[8][8];
+    uint8_t carry[8][8];
+  };
+  static constexpr pattern PATTERN = [] {
+    pattern result{};
+    for (uint64_t r = 0; r < 8; ++r)
+      for (uint64_t w = 0; w < 8; ++w) {
+        uint64_t residue = RESIDUES[r] * RESIDUES[w] % 30;
+        result.mask[r][w] = uint8_t(1u << POSITION[residue]);
+        result.carry[r][w] =
+            uint8_t((residue + RESIDUES[r] * STEPS[w]) / 30);
+      }
+    return result;
+  }();
 
+  static bool hasSlot(uint64_t number) {
+    return POSITION[number % 30] != NONE;
+  }
+  static uint64_t slot(uint64_t number) {
+    return number / 30 * 8 + POSITION[number % 30];
+  }
+  static uint64_t slotsBelow(uint64_t number) {
+    uint64_t residue = number % 30, below = 0;
+    while (below < 8 && RESIDUES[below] < residue)
+      ++below;
+    return number / 30 * 8 + below;
+  }
+  static uint64_t value(uint64_t slot) {
+    return slot / 8 * 30 + RESIDUES[slot % 8];
+  }
+
+  struct cursor {
+    uint64_t byte;
+    uint8_t wheel; // position of the current cofactor q
+  };
+
+  static cursor start(uint64_t prime, uint64_t window_slot) {
+    uint64_t low = window_slot / 8 * 30;
+    uint64_t factor = std::max(prime, (low + prime - 1) / prime);
+    while (POSITION[factor % 30] == NONE)
+      ++factor;
+    return {prime * factor / 30 - window_slot / 8, POSITION[factor % 30]};
+  }
+
+  static void cross(uint64_t *window, uint64_t bits, uint64_t prime,
+                    cursor &next) {
+    static_assert(std::endian::native == std::endian::little,
+                  "wheel bytes are addressed inside 64-bit words");
+    auto *bytes = reinterpret_cast<uint8_t *>(window);
+    const uint64_t end = (bits + 7) / 8, k = prime / 30;
+    const uint8_t r = POSITION[prime % 30];
+    uint64_t byte = next.byte;
+    uint8_t w = next.wheel;
+    while (byte < end) {
+      bytes[byte] &= uint8_t(~PATTERN.mask[r][w]);
+      byte += k * STEPS[w] + PATTERN.carry[r][w];
+      w = (w + 1) & 7;
+    }
+    next = {byte - bits / 8, w};
+  }
+};
+
+// Segmented sieve of Eratosthenes over [lo, hi). The interval is walked in
+// windows of slots small enough to stay in cache, and every base prime
+// keeps its next multiple from one window to the next, so memory is
+// proportional to sqrt(hi) plus the window. Windows start on word
+// boundaries, so they can be copied straight into a table.
+template <typename Layout> class segmentedSieve {
 public:
-  sieve() : mData(1024, 1) {
-    mData.set(0, 0);
-    mData.set(1, 0);
-    sieve::__sieve(*this);
+  static constexpr uint64_t DEFAULT_SEGMENT_BYTES = 32 * 1024;
+
+private:
+  uint64_t mLowSlot, mHighSlot; // slots of the interval
+  uint64_t mStart = 0;          // first slot of the current window
+  uint64_t mNext;               // first slot of the following window
+  uint64_t mBits = 0;           // slots in the current window
+  uint64_t mSegmentBits;
+  std::vector<uint32_t> mPrimes;
+  std::vector<typename Layout::cursor> mCursors;
+  std::vector<uint64_t> mWindow;
+
+public:
+  // Primes that cross off composites below hi in this layout
+  static std::vector<uint32_t> basePrimes(uint64_t hi) {
+    std::vector<uint32_t> primes;
+    if (hi <= 2)
+      return primes;
+    for (uint32_t prime : oddPrimesUpTo(isqrt(hi - 1)))
+      if (Layout::hasSlot(prime))
+        primes.push_back(prime);
+    return primes;
+  }
+
+  // primes must be basePrimes(hi); passing them in lets several engines
+  // over parts of one interval share the work
+  segmentedSieve(uint64_t lo, uint64_t hi, std::vector<uint32_t> primes,
+                 uint64_t segment_bytes = DEFAULT_SEGMENT_BYTES)
+      : mLowSlot(Layout::slotsBelow(lo)),
+        mHighSlot(Layout::slotsBelow(std::max(lo, hi))),
+        mNext(mLowSlot & ~uint64_t(63)),
+        mSegmentBits(std::max<uint64_t>(segment_bytes / 8, 1) * 64),
+        mPrimes(std::move(primes)) {
+    seek(mNext);
+  }
+
+  segmentedSieve(uint64_t lo, uint64_t hi,
+                 uint64_t segment_bytes = DEFAULT_SEGMENT_BYTES)
+      : segmentedSieve(lo, hi, basePrimes(hi), segment_bytes) {}
+
+  // Makes the next window start at slot, a multiple of 64. Windows after
+  // it follow on contiguously.
+  void seek(uint64_t slot) {
+    mNext = slot;
+    mCursors.clear();
+    mCursors.reserve(mPrimes.size());
+    for (uint64_t prime : mPrimes)
+      mCursors.push_back(Layout::start(prime, slot));
+  }
+
+  [[nodiscard]] uint64_t segmentBits() const { return mSegmentBits; }
+
+  // Sieves the next window, returns false once the interval is exhausted
+  bool nextSegment() {
+    if (mNext >= mHighSlot) {
+      mBits = 0;
+      return false;
+    }
+    mStart = mNext;
+    mBits = std::min(mSegmentBits, mHighSlot - mStart);
+    mNext = mStart + mBits;
+
+    mWindow.assign((mBits + 63) / 64, ~uint64_t(0));
+    for (uint64_t idx = 0; idx < mPrimes.size(); ++idx)
+      Layout::cross(mWindow.data(), mBits, mPrimes[idx], mCursors[idx]);
+
+    if (mBits % 64)
+      mWindow.back() &= (uint64_t(1) << (mBits % 64)) - 1;
+    if (mStart < mLowSlot)
+      mWindow[0] &= ~((uint64_t(1) << (mLowSlot - mStart)) - 1);
+    if (mStart == 0)
+      mWindow[0] &= ~uint64_t(1); // slot 0 is the number 1
+    return true;
   }
-  sieve(uint64_t n) : mData(n, 1) {
-    mData.set(0, 0);
-    mData.set(1, 0);
-    sieve::__sieve(*this);
+
+  // Window layout: bit i of bitmap() is the slot firstSlot() + i
+  [[nodiscard]] uint64_t firstSlot() const { return mStart; }
+  [[nodiscard]] uint64_t bitCount() const { return mBits; }
+  [[nodiscard]] const std::vector<uint64_t> &bitmap() const { return mWindow; }
+
+  // Calls callback with every prime of the current window that has a slot,
+  // in order
+  template <typename Callback> void forEachPrime(Callback &&callback) const {
+    for (uint64_t word = 0; word < mWindow.size(); ++word)
+      for (uint64_t bits = mWindow[word]; bits; bits &= bits - 1)
+        callback(Layout::value(mStart + word * 64 + std::countr_zero(bits)));
   }
+};
+
+// Calls callback with every prime in [lo, hi), in increasing order
+template <typename Layout = wheel30Layout, typename Callback>
+void forEachPrime(uint64_t lo, uint64_t hi, Callback &&callback) {
+  for (uint64_t prime : Layout::PRESIEVED)
+    if (lo <= prime && prime < hi)
+      callback(prime);
+  segmentedSieve<Layout> engine(lo, hi);
+  while (engine.nextSegment())
+    engine.forEachPrime(callback);
+}
 
-  [[nodiscard]] uint64_t size() const { return mData.size(); }
+// Lazy input range over the primes in [lo, hi), sieved one window at a time
+// as it is iterated, so memory stays at one window plus the base primes:
+//
+//   for (uint64_t prime : primeRange(lo, hi)) ...
+template <typename Layout = wheel30Layout>
+class primeRange : public std::ranges::view_interface<primeRange<Layout>> {
+  uint64_t mLow = 0, mHigh = 0;
+  segmentedSieve<Layout> mEngine{0, 0};
+  uint64_t mPresieved = 0; // next entry of Layout::PRESIEVED to look at
+  uint64_t mWord = 0;      // next word of the window to load
+  uint64_t mBits = 0;      // unvisited bits of word mWord - 1
+  uint64_t mCurrent = 0;
+  bool mDone = false;
+
+  void advance() {
+    while (mPresieved < Layout::PRESIEVED.size()) {
+      uint64_t prime = Layout::PRESIEVED[mPresieved++];
+      if (mLow <= prime && prime < mHigh) {
+        mCurrent = prime;
+        return;
+      }
+    }
+    while (!mBits) {
+      if (mWord >= mEngine.bitmap().size()) {
+        if (!mEngine.nextSegment()) {
+          mDone = true;
+          return;
+        }
+        mWord = 0;
+        continue;
+      }
+      mBits = mEngine.bitmap()[mWord++];
+    }
+    mCurrent = Layout::value(mEngine.firstSlot() + (mWord - 1) * 64 +
+                             std::countr_zero(mBits));
+    mBits &= mBits - 1;
+  }
 
+public:
+  class iterator {
+    primeRange *mParent = nullptr;
+
+  public:
+    using value_type = uint64_t;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    explicit iterator(primeRange *parent) : mParent(parent) {}
+
+    uint64_t operator*() const { return mParent->mCurrent; }
+    iterator &operator++() {
+      mParent->advance();
+      return *this;
+    }
+    void operator++(int) { ++*this; }
+    bool operator==(std::default_sentinel_t) const { return mParent->mDone; }
+  };
+
+  primeRange() = default;
+  primeRange(uint64_t lo, uint64_t hi)
+      : mLow(lo), mHigh(hi), mEngine(lo, hi) {}
+
+  // Single pass: begin() may only be called once
+  iterator begin() {
+    advance();
+    return iterator(this);
+  }
+  std::default_sentinel_t end() const { return std::default_sentinel; }
+};
+
+// Prime table for [0, size()) stored in one of the layouts above:
+// oddLayout takes half the memory of a bit per integer, wheel30Layout
+// 3.75 times less. With more than one thread the windows are sieved by a
+// work-stealing pool; every window lands in its own words of the table,
+// so the result is identical to the serial one.
+template <typename Layout> class basicSieve {
+  mapping::tableArray<uint64_t> mData; // one bit per slot
+  uint64_t mSize = 0;
+  unsigned mThreads = 1;
+  // Base primes for sieving up to mBaseLimit^2, kept between expansions
+  std::vector<uint32_t> mBasePrimes;
+  uint64_t mBaseLimit = 0;
+
+  // Rank/select index over mData. Every 64 words (a superblock) store the
+  // number of set bits before them, plus 16-bit counts from the start of
+  // the superblock for each of its eight 512-bit blocks: about 5% on top
+  // of the table. mSelect samples the superblock holding every
+  // SELECT_SAMPLE-th set bit.
+  static constexpr uint64_t SUPERBLOCK_WORDS = 64;
+  static constexpr uint64_t BLOCK_WORDS = 8;
+  static constexpr uint64_t SELECT_SAMPLE = 1024;
+  struct rankEntry {
+    uint64_t base;
+    uint16_t blocks[SUPERBLOCK_WORDS / BLOCK_WORDS];
+  };
+  mapping::tableArray<rankEntry> mRank;
+  mapping::tableArray<uint32_t> mSelect;
+  uint64_t mSlotPrimes = 0; // set bits in mData
+
+  [[nodiscard]] bool at(uint64_t slot) const {
+    return (mData[slot >> 6] >> (slot & 63)) & 1;
+  }
+
+  [[nodiscard]] uint64_t popcount(uint64_t first, uint64_t last) const {
+    uint64_t count = 0;
+    for (; first < last; ++first)
+      count += std::popcount(mData[first]);
+    return count;
+  }
+
+  // Rebuilds the index from the superblock holding slot on; words before
+  // it are unchanged
+  void buildIndex(uint64_t slot) {
+    const uint64_t words = mData.size();
+    const uint64_t first = slot / 64 / SUPERBLOCK_WORDS;
+    const uint64_t supers = (words + SUPERBLOCK_WORDS - 1) / SUPERBLOCK_WORDS;
+    uint64_t total = 0;
+    if (first > 0)
+      total = mRank[first - 1].base +
+              popcount((first - 1) * SUPERBLOCK_WORDS,
+                       first * SUPERBLOCK_WORDS);
+    std::vector<rankEntry> &ranks = mRank.owned();
+    std::vector<uint32_t> &samples = mSelect.owned();
+    ranks.resize(supers);
+    samples.resize(std::min<uint64_t>(
+        samples.size(), (total + SELECT_SAMPLE - 1) / SELECT_SAMPLE));
+
+    for (uint64_t super = first; super < supers; ++super) {
+      rankEntry &entry = ranks[super];
+      entry.base = total;
+      uint64_t inside = 0;
+      for (uint64_t block = 0; block < SUPERBLOCK_WORDS / BLOCK_WORDS;
+           ++block) {
+        entry.blocks[block] = static_cast<uint16_t>(inside);
+        uint64_t word = super * SUPERBLOCK_WORDS + block * BLOCK_WORDS;
+        inside += popcount(std::min(word, words),
+                           std::min(word + BLOCK_WORDS, words));
+      }
+      total += inside;
+      while (samples.size() * SELECT_SAMPLE < total)
+        samples.push_back(static_cast<uint32_t>(super));
+    }
+    mSlotPrimes = total;
+  }
+
+  // Set bits in slots [0, slot)
+  [[nodiscard]] uint64_t rank(uint64_t slot) const {
+    const uint64_t word = slot / 64;
+    if (word >= mData.size())
+      return mSlotPrimes;
+    const rankEntry &entry = mRank[word / SUPERBLOCK_WORDS];
+    uint64_t count =
+        entry.base + entry.blocks[word % SUPERBLOCK_WORDS / BLOCK_WORDS] +
+        popcount(word & ~(BLOCK_WORDS - 1), word);
+    if (slot % 64)
+      count += std::popcount(mData[word] << (64 - slot % 64));
+    return count;
+  }
+
+  // Slot of the set bit with the given rank (from 0), k < mSlotPrimes
+  [[nodiscard]] uint64_t select(uint64_t k) const {
+    uint64_t super = mSelect[k / SELECT_SAMPLE];
+    while (super + 1 < mRank.size() && mRank[super + 1].base <= k)
+      ++super;
+    const rankEntry &entry = mRank[super];
+    k -= entry.base;
+    uint64_t block = SUPERBLOCK_WORDS / BLOCK_WORDS - 1;
+    while (entry.blocks[block] > k)
+      --block;
+    k -= entry.blocks[block];
+    uint64_t word = super * SUPERBLOCK_WORDS + block * BLOCK_WORDS;
+    for (uint64_t count; (count = std::popcount(mData[word])) <= k; ++word)
+      k -= count;
+    uint64_t bits = mData[word];
+    for (; k; --k)
+      bits &= bits - 1;
+    return word * 64 + std::countr_zero(bits);
+  }
+
+  // Presieved primes below mSize
+  [[nodiscard]] uint64_t presievedCount() const {
+    return std::ranges::count_if(Layout::PRESIEVED,
+                                 [&](uint64_t prime) { return prime < mSize; });
+  }
+
+  // Brings the base primes up to sqrt(mSize - 1). Where the table already
+  // reaches that far (below known) they are read from it, otherwise they
+  // are sieved from scratch.
+  void extendBasePrimes(uint64_t known) {
+    const uint64_t limit = mSize > 2 ? isqrt(mSize - 1) : 0;
+    if (limit <= mBaseLimit)
+      return;
+    if (limit < known) {
+      for (uint64_t slot = Layout::slotsBelow(mBaseLimit + 1),
+                    end = Layout::slotsBelow(limit + 1);
+           slot < end; ++slot)
+        if (at(slot))
+          mBasePrimes.push_back(static_cast<uint32_t>(Layout::value(slot)));
+    } else {
+      mBasePrimes = segmentedSieve<Layout>::basePrimes(mSize);
+    }
+    mBaseLimit = limit;
+  }
+
+  // Sieves [from, mSize) into the table. Words below from keep their bits;
+  // the window straddling from is merged into them.
+  static void __sieve(basicSieve &mSieve, uint64_t from) {
+    mSieve.extendBasePrimes(from);
+    if (mSieve.mThreads > 1)
+      return __parallel_sieve(mSieve, from);
+    segmentedSieve<Layout> engine(from, mSieve.mSize, mSieve.mBasePrimes);
+    while (engine.nextSegment())
+      __merge(mSieve, engine);
+  }
+
+  static void __merge(basicSieve &mSieve,
+                      const segmentedSieve<Layout> &engine) {
+    uint64_t *out = mSieve.mData.owned().data() + engine.firstSlot() / 64;
+    for (uint64_t word : engine.bitmap())
+      *out++ |= word;
+  }
+
+  static void __parallel_sieve(basicSieve &mSieve, uint64_t from) {
+    const uint64_t n = mSieve.mSize;
+    parallel::threadPool pool(mSieve.mThreads);
+    // One engine (window buffer and prime cursors) per worker
+    std::vector<segmentedSieve<Layout>> engines(
+        pool.size(), {from, n, mSieve.mBasePrimes});
+    std::vector<uint64_t> last(pool.size(), UINT64_MAX);
+    const uint64_t window = engines[0].segmentBits();
+    const uint64_t first = Layout::slotsBelow(from) & ~uint64_t(63);
+    const auto tasks = static_cast<uint32_t>(
+        (Layout::slotsBelow(n) - first + window - 1) / window);
+
+    pool.forEach(tasks, [&](unsigned worker, uint32_t task) {
+      segmentedSieve<Layout> &engine = engines[worker];
+      // Consecutive windows keep the cursors; a stolen one repositions them
+      if (last[worker] + 1 != task)
+        engine.seek(first + task * window);
+      last[worker] = task;
+      engine.nextSegment();
+      __merge(mSieve, engine);
+    });
+  }
+
+  // Saved table: a fileHeader, then the bitmap words, the rank entries
+  // and the select samples padded to a whole word, all in native byte
+  // order. The checksum covers everything after the header.
+  static constexpr char FILE_MAGIC[8] = {'P', 'R', 'S', 'I', 'E', 'V', 'E', 0};
+  static constexpr uint32_t FILE_VERSION = 1;
+  static constexpr uint32_t FILE_BYTE_ORDER = 0x01020304;
+  struct fileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t layout; // Layout::ID
+    uint32_t byteOrder;
+    uint32_t reserved;
+    uint64_t size; // the table covers [0, size)
+    uint64_t words;
+    uint64_t rankEntries;
+    uint64_t selectSamples;
+    uint64_t slotPrimes;
+    uint64_t checksum;
+  };
+
+  static uint64_t selectBytes(uint64_t samples) {
+    return (samples * sizeof(uint32_t) + 7) & ~uint64_t(7);
+  }
+
+  // Multiply-rotate hash over bytes in four independent lanes, so it runs
+  // near memory speed; a partial last word is padded with zeros
+  static uint64_t hashBytes(const void *data, uint64_t bytes, uint64_t seed) {
+    constexpr uint64_t MULTIPLIER = 0x9e3779b97f4a7c15;
+    const auto *in = static_cast<const unsigned char *>(data);
+    uint64_t lanes[4] = {seed, seed ^ 1, seed ^ 2, seed ^ 3};
+    auto mix = [&](const unsigned char *chunk) {
+      for (unsigned lane = 0; lane < 4; ++lane) {
+        uint64_t word;
+        std::memcpy(&word, chunk + 8 * lane, 8);
+        lanes[lane] = std::rotl((lanes[lane] ^ word) * MULTIPLIER, 29);
+      }
+    };
+    uint64_t offset = 0;
+    for (; offset + 32 <= bytes; offset += 32)
+      mix(in + offset);
+    unsigned char tail[32] = {};
+    std::memcpy(tail, in + offset, bytes - offset);
+    mix(tail);
+    uint64_t result = bytes;
+    for (uint64_t lane : lanes)
+      result = std::rotl((result ^ lane) * MULTIPLIER, 29);
+    return result;
+  }
+
+  [[nodiscard]] uint64_t checksum() const {
+    uint64_t hash = hashBytes(mData.data(), mData.size() * sizeof(uint64_t), 0);
+    hash = hashBytes(mRank.data(), mRank.size() * sizeof(rankEntry), hash);
+    // Padding bytes are zero on disk, which hashBytes assumes anyway
+    return hashBytes(mSelect.data(), mSelect.size() * sizeof(uint32_t), hash);
+  }
+
+  // Views the table saved in file. Base primes are rebuilt from the table
+  // on the first expand().
+  basicSieve(std::shared_ptr<const mapping::fileMapping> file, bool verify) {
+    fileHeader header;
+    if (file->size() < sizeof(header))
+      throw std::runtime_error("Not a saved sieve");
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)))
+      throw std::runtime_error("Not a saved sieve");
+    if (header.version != FILE_VERSION)
+      throw std::runtime_error("Unsupported saved sieve version");
+    if (header.byteOrder != FILE_BYTE_ORDER)
+      throw std::runtime_error("Saved sieve has a different byte order");
+    if (header.layout != Layout::ID)
+      throw std::runtime_error("Saved sieve uses a different layout");
+
+    const uint64_t payload = file->size() - sizeof(header);
+    const uint64_t words = (Layout::slotsBelow(header.size) + 63) / 64;
+    if (header.words != words ||
+        header.rankEntries !=
+            (words + SUPERBLOCK_WORDS - 1) / SUPERBLOCK_WORDS ||
+        header.slotPrimes > words * 64 ||
+        header.selectSamples !=
+            (header.slotPrimes + SELECT_SAMPLE - 1) / SELECT_SAMPLE ||
+        words > payload / sizeof(uint64_t) ||
+        header.rankEntries > payload / sizeof(rankEntry) ||
+        words * sizeof(uint64_t) + header.rankEntries * sizeof(rankEntry) +
+                selectBytes(header.selectSamples) !=
+            payload)
+      throw std::runtime_error("Saved sieve is truncated or inconsistent");
+
+    uint64_t offset = sizeof(header);
+    mData = {file, offset, words};
+    offset += words * sizeof(uint64_t);
+    mRank = {file, offset, header.rankEntries};
+    offset += header.rankEntries * sizeof(rankEntry);
+    mSelect = {file, offset, header.selectSamples};
+    mSize = header.size;
+    mSlotPrimes = header.slotPrimes;
+    if (verify && checksum() != header.checksum)
+      throw std::runtime_error("Saved sieve fails its checksum");
+  }
+
+public:
+  using layout = Layout;
+
+  basicSieve() : basicSieve(1024) {}
+  // threads == 0 uses every hardware thread
+  basicSieve(uint64_t n, unsigned threads = 1)
+      : mData((Layout::slotsBelow(n) + 63) / 64), mSize(n),
+        mThreads(threads ? threads : parallel::defaultThreads()) {
+    basicSieve::__sieve(*this, 0);
+    buildIndex(0);
+  }
+
+  [[nodiscard]] uint64_t size() const { return mSize; }
+
+  // Writes the table and its rank index to path. The file is written
+  // under a temporary name and renamed into place, so processes that
+  // have the old file mapped keep a consistent view.
+  void save(const std::string &path) const {
+    fileHeader header{};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = FILE_VERSION;
+    header.layout = Layout::ID;
+    header.byteOrder = FILE_BYTE_ORDER;
+    header.size = mSize;
+    header.words = mData.size();
+    header.rankEntries = mRank.size();
+    header.selectSamples = mSelect.size();
+    header.slotPrimes = mSlotPrimes;
+    header.checksum = checksum();
+
+    const std::string temporary = path + ".tmp";
+    {
+      std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+      auto write = [&](const void *data, uint64_t bytes) {
+        out.write(static_cast<const char *>(data),
+                  static_cast<std::streamsize>(bytes));
+      };
+      write(&header, sizeof(header));
+      write(mData.data(), mData.size() * sizeof(uint64_t));
+      write(mRank.data(), mRank.size() * sizeof(rankEntry));
+      write(mSelect.data(), mSelect.size() * sizeof(uint32_t));
+      const char padding[8] = {};
+      write(padding, selectBytes(mSelect.size()) -
+                         mSelect.size() * sizeof(uint32_t));
+      if (!out.flush())
+        throw std::runtime_error("Cannot write " + temporary);
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+      throw std::runtime_error("Cannot rename " + temporary + " to " + path);
+  }
+
+  // Opens a table written by save() without sieving: the file is mapped
+  // read-only and shared through the page cache by every process that
+  // opens it. verify == false skips the checksum pass over the whole
+  // file for the fastest startup. Queries work directly on the mapping;
+  // expand() first copies the table into memory.
+  [[nodiscard]] static basicSieve open_mapped(const std::string &path,
+                                              bool verify = true) {
+    return basicSieve(std::make_shared<const mapping::fileMapping>(path),
+                      verify);
+  }
+
+  // Threads used by later expand() calls
+  [[nodiscard]] unsigned threads() const { return mThreads; }
+  void setThreads(unsigned threads) {
+    mThreads = threads ? threads : parallel::defaultThreads();
+  }
+
+  // Grows the table to [0, n), sieving only the new numbers
   void expand(uint64_t n) {
-    if (n <= mData.size())
+    if (n <= mSize)
       return;
-    mData.expand(n, 1);
-    __sieve(*this);
+    const uint64_t old_size = mSize;
+    mData.owned().resize((Layout::slotsBelow(n) + 63) / 64, 0);
+    mSize = n;
+    __sieve(*this, old_size);
+    buildIndex(Layout::slotsBelow(old_size));
   }
 
+  // Number of primes <= x
+  [[nodiscard]] uint64_t primePi(uint64_t x) const {
+    if (x >= mSize)
+      throw std::out_of_range("Given number is too large for this sieve");
+    return std::ranges::count_if(Layout::PRESIEVED,
+                                 [&](uint64_t prime) { return prime <= x; }) +
+           rank(Layout::slotsBelow(x + 1));
+  }
+
+  // Number of primes in [lo, hi)
+  [[nodiscard]] uint64_t countPrimes(uint64_t lo, uint64_t hi) const {
+    if (hi <= lo)
+      return 0;
+    return primePi(hi - 1) - (lo ? primePi(lo - 1) : 0);
+  }
+
+  // The n-th prime, counting 2 as the first
+  [[nodiscard]] uint64_t nthPrime(uint64_t n) const {
+    if (n == 0)
+      throw std::invalid_argument("Primes are counted from 1");
+    const uint64_t presieved = presievedCount();
+    if (n <= presieved)
+      return Layout::PRESIEVED[n - 1];
+    if (n - presieved > mSlotPrimes)
+      throw std::out_of_range("This sieve holds fewer primes");
+    return Layout::value(select(n - presieved - 1));
+  }
+
+  // Largest prime below number, or 1 if there is none
   [[nodiscard]] uint64_t prev(uint64_t number) const {
-    if (number >= mData.size())
+    if (number >= mSize)
       throw std::out_of_range("Given number is too large for this sieve");
-    for (auto idx = number - (!(number & 1) ? 1 : 2); idx >= 2; idx -= 2) {
-      if (mData.at(idx))
-        return idx;
+    if (uint64_t slot = Layout::slotsBelow(number); slot > 0) {
+      uint64_t word = (slot - 1) / 64;
+      uint64_t bits = mData[word] & (~uint64_t(0) >> (63 - (slot - 1) % 64));
+      while (!bits && word > 0)
+        bits = mData[--word];
+      if (bits)
+        return Layout::value(word * 64 + 63 - std::countl_zero(bits));
     }
+    for (auto prime = Layout::PRESIEVED.rbegin();
+         prime != Layout::PRESIEVED.rend(); ++prime)
+      if (*prime < number)
+        return *prime;
     return 1;
   }
+  // Smallest prime above number, or 0 if the sieve has none
   [[nodiscard]] uint64_t next(uint64_t number) const {
-    if (number >= mData.size())
+    if (number >= mSize)
       throw std::runtime_error("Given number is too large for this sieve");
-    for (auto idx = number + (!(number & 1) ? 1 : 2); idx < mData.size();
-         idx += 2) {
-      if (mData.at(idx))
-        return idx;
-    }
-    return 0;
+    for (uint64_t prime : Layout::PRESIEVED)
+      if (prime > number && prime < mSize)
+        return prime;
+    // Bits past the last slot are always clear
+    uint64_t slot = Layout::slotsBelow(number + 1), word = slot / 64;
+    if (word >= mData.size())
+      return 0;
+    uint64_t bits = mData[word] & (~uint64_t(0) << (slot % 64));
+    while (!bits && ++word < mData.size())
+      bits = mData[word];
+    return bits ? Layout::value(word * 64 + std::countr_zero(bits)) : 0;
   }
+  // Answered from the table below size(), by the deterministic 64-bit
+  // test above it
   [[nodiscard]] bool isPrime(uint64_t number) const {
-    if (number <= 1)
-      return false;
-    if (number <= 3)
-      return true;
-    if (!(number & 1))
-      return false;
-    return mData.at(number);
+    if (number >= mSize)
+      return primality::isPrime(number);
+    if (!Layout::hasSlot(number))
+      return std::ranges::find(Layout::PRESIEVED, number) !=
+             Layout::PRESIEVED.end();
+    return at(Layout::slot(number));
   }
-  friend std::ostream &operator<<(std::ostream &os, const sieve &sieve) {
-    os << 2 << ' ';
-    for (uint64_t prime = 3; prime < sieve.mData.size(); prime += 2) {
-      if (sieve.isPrime(prime))
-        os << prime << ' ';
+  // Tests every number, writing the answers to results (of the same
+  // size). Numbers past the table go through the 64-bit test as one
+  // batch on threads() threads.
+  void isPrime(std::span<const uint64_t> numbers,
+               std::span<bool> results) const {
+    if (results.size() != numbers.size())
+      throw std::invalid_argument("Need one result per number");
+    std::vector<uint64_t> beyond, where;
+    for (uint64_t idx = 0; idx < numbers.size(); ++idx) {
+      if (numbers[idx] < mSize) {
+        results[idx] = isPrime(numbers[idx]);
+      } else {
+        beyond.push_back(numbers[idx]);
+        where.push_back(idx);
+      }
     }
+    if (beyond.empty())
+      return;
+    std::unique_ptr<bool[]> answers(new bool[beyond.size()]);
+    primality::isPrime(beyond, {answers.get(), beyond.size()}, mThreads);
+    for (uint64_t idx = 0; idx < beyond.size(); ++idx)
+      results[where[idx]] = answers[idx];
+  }
+  friend std::ostream &operator<<(std::ostream &os, const basicSieve &sieve) {
+    for (uint64_t prime : Layout::PRESIEVED)
+      if (prime < sieve.mSize)
+        os << prime << ' ';
+    for (uint64_t slot = 0, end = Layout::slotsBelow(sieve.mSize); slot < end;
+         ++slot)
+      if (sieve.at(slot))
+        os << Layout::value(slot) << ' ';
     return os;
   }
 };
 
+using sieve = basicSieve<wheel30Layout>;
+
 #endif // !SIEVE_HPP
@@ -0,0 +1,123 @@
+#pragma once
+#ifndef WIRE_HPP
+#define WIRE_HPP
+#include <array>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "RadInt.hpp"
+#include "bits.hpp"
+
+// Compact binary encoding for big integers moving between parties. An
+// integer is a LEB128 varint holding (byte length << 1 | negative),
+// followed by that many big-endian magnitude bytes; zero is the single
+// byte 0. Every value has exactly one encoding: readers reject overlong
+// varints, varints past 64 bits and magnitudes with leading zero bytes.
+// Values are appended to a std::string and read back from a
+// std::string_view that is advanced past them.
+namespace wire {
+
+// Seven bits per byte, high bit set on all but the last
+inline void writeVarint(std::string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+inline uint64_t readVarint(std::string_view &in) {
+  uint64_t value = 0;
+  for (unsigned shift = 0; shift < 64 && !in.empty(); shift += 7) {
+    const auto byte = static_cast<uint8_t>(in.front());
+    in.remove_prefix(1);
+    // The tenth byte only has room for bit 63
+    if (shift == 63 && byte > 1)
+      throw std::runtime_error("Wire varint overflows 64 bits");
+    value |= uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      if (byte == 0 && shift > 0)
+        throw std::runtime_error("Non-canonical wire varint");
+      return value;
+    }
+  }
+  throw std::runtime_error("Malformed wire varint");
+}
+
+namespace detail {
+inline void writeMagnitude(std::string &out, const std::vector<uint8_t> &bytes,
+                           bool negative) {
+  writeVarint(out, uint64_t(bytes.size()) << 1 | negative);
+  out.append(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+// Magnitude bytes of the next integer; negative is set from its header
+inline std::string_view readMagnitude(std::string_view &in, bool &negative) {
+  const uint64_t header = readVarint(in);
+  const uint64_t length = header >> 1;
+  negative = header & 1;
+  if (length > in.size() || (length == 0 && negative))
+    throw std::runtime_error("Malformed wire integer");
+  std::string_view bytes = in.substr(0, length);
+  if (length > 0 && bytes.front() == 0)
+    throw std::runtime_error("Non-canonical wire integer");
+  in.remove_prefix(length);
+  return bytes;
+}
+
+inline std::span<const uint8_t> asBytes(std::string_view bytes) {
+  return {reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size()};
+}
+} // namespace detail
+
+inline void write(std::string &out, const cpp_int &value) {
+  detail::writeMagnitude(out, functions::toBytes(value), value < 0);
+}
+
+inline void write(std::string &out, const bits::container &value) {
+  detail::writeMagnitude(out, value.to_bytes(), false);
+}
+
+template <typename T, size_t N>
+void write(std::string &out, const std::array<T, N> &values) {
+  for (const T &value : values)
+    write(out, value);
+}
+
+inline void read(std::string_view &in, cpp_int &value) {
+  bool negative;
+  value = functions::fromBytes(
+      detail::asBytes(detail::readMagnitude(in, negative)));
+  if (negative)
+    value = -value;
+}
+
+inline void read(std::string_view &in, bits::container &value) {
+  bool negative;
+  std::span<const uint8_t> bytes =
+      detail::asBytes(detail::readMagnitude(in, negative));
+  if (negative)
+    throw std::runtime_error("Containers hold no negative values");
+  value = bits::container::from_bytes(bytes.data(), bytes.size());
+}
+
+template <typename T, size_t N>
+void read(std::string_view &in, std::array<T, N> &values) {
+  for (T &value : values)
+    read(in, value);
+}
+
+// The encoding of a single value, as one string
+template <typename T> std::string encode(const T &value) {
+  std::string out;
+  write(out, value);
+  return out;
+}
+
+} // namespace wire
+
+#endif // !WIRE_HPP
@@ -0,0 +1,33 @@
+#pragma once
+#ifndef WORD_HPP
+#define WORD_HPP
+
+#include <cstdint>
+
+// Word-sized helpers shared by the limb arithmetic, the NTT, the native
+// primality test and the cpp_int code in RadInt.hpp. Kept apart from
+// limbs.hpp, which includes ntt.hpp.
+namespace bits::limbs {
+
+// odd^-1 mod 2^64 for odd `odd`
+constexpr uint64_t inverse_word(uint64_t odd) {
+  // Newton iteration doubles the correct low bits: 3, 6, 12, 24, 48, 96
+  uint64_t inverse = odd;
+  for (int step = 0; step < 5; ++step)
+    inverse *= 2 - odd * inverse;
+  return inverse;
+}
+
+// Sliding window width for an exponent of exp_bits bits: the size at
+// which a table of 2^(w - 1) odd powers stops paying for itself
+constexpr unsigned window_bits(uint64_t exp_bits) {
+  return exp_bits > 671   ? 6
+         : exp_bits > 239 ? 5
+         : exp_bits > 79  ? 4
+         : exp_bits > 23  ? 3
+                          : 2;
+}
+
+} // namespace bits::limbs
+
+#endif // !WORD_HPP